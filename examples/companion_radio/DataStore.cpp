@@ -23,6 +23,16 @@ static File openWrite(FILESYSTEM* _fs, const char* filename) {
 #endif
 }
 
+static File openReadWrite(FILESYSTEM* _fs, const char* filename) {
+#if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+  return _fs->open(filename, FILE_O_WRITE);   // keeps existing content, caller must seek()
+#elif defined(RP2040_PLATFORM)
+  return _fs->open(filename, "r+");
+#else
+  return _fs->open(filename, "r+", false);
+#endif
+}
+
 void DataStore::begin() {
 #if defined(RP2040_PLATFORM)
   identity_store.begin();
@@ -446,3 +456,102 @@ bool DataStore::putBlobByKey(const uint8_t key[], int key_len, const uint8_t src
   return false; // error
 }
 #endif
+
+#define MSG_SPOOL_FILE    "/msg_spool"
+#define MSG_SPOOL_MAGIC   0x4D535031   // 'MSP1'
+
+struct MsgSpoolHdr {
+  uint32_t magic;
+  uint16_t num_slots;
+  uint16_t head;
+  uint16_t count;
+  uint16_t reserved;
+};
+
+struct MsgSpoolSlot {
+  uint8_t len;
+  uint8_t buf[MAX_FRAME_SIZE];
+};
+
+#define MSG_SPOOL_SLOT_POS(slot)   (sizeof(MsgSpoolHdr) + (uint32_t)(slot) * sizeof(MsgSpoolSlot))
+
+bool DataStore::openMsgSpool(uint16_t num_slots, uint16_t& head, uint16_t& count) {
+  if (_fs->exists(MSG_SPOOL_FILE)) {
+    File file = openRead(MSG_SPOOL_FILE);
+    if (file) {
+      MsgSpoolHdr hdr;
+      bool success = (file.read((uint8_t *) &hdr, sizeof(hdr)) == sizeof(hdr));
+      file.close();
+      if (success && hdr.magic == MSG_SPOOL_MAGIC && hdr.num_slots == num_slots
+          && hdr.head < num_slots && hdr.count <= num_slots) {
+        head = hdr.head;
+        count = hdr.count;
+        return true;
+      }
+    }
+    // otherwise, corrupt or different size, so re-create
+  }
+
+  File file = openWrite(_fs, MSG_SPOOL_FILE);
+  if (!file) return false;
+
+  MsgSpoolHdr hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.magic = MSG_SPOOL_MAGIC;
+  hdr.num_slots = num_slots;
+  bool success = (file.write((uint8_t *) &hdr, sizeof(hdr)) == sizeof(hdr));
+
+  MsgSpoolSlot zeroes;
+  memset(&zeroes, 0, sizeof(zeroes));
+  for (int i = 0; success && i < num_slots; i++) {     // pre-allocate to fixed size
+    success = (file.write((uint8_t *) &zeroes, sizeof(zeroes)) == sizeof(zeroes));
+  }
+  file.close();
+
+  if (!success) {
+    _fs->remove(MSG_SPOOL_FILE);   // out of space
+    return false;
+  }
+  head = count = 0;
+  return true;
+}
+
+bool DataStore::saveMsgSpoolState(uint16_t head, uint16_t count) {
+  File file = openReadWrite(_fs, MSG_SPOOL_FILE);
+  if (!file) return false;
+
+  MsgSpoolHdr hdr;
+  bool success = file.seek(0) && (file.read((uint8_t *) &hdr, sizeof(hdr)) == sizeof(hdr));
+  if (success) {
+    hdr.head = head;
+    hdr.count = count;
+    success = file.seek(0) && (file.write((uint8_t *) &hdr, sizeof(hdr)) == sizeof(hdr));
+  }
+  file.close();
+  return success;
+}
+
+bool DataStore::writeMsgSpoolSlot(uint16_t slot, const uint8_t frame[], uint8_t len) {
+  if (len > MAX_FRAME_SIZE) return false;
+
+  File file = openReadWrite(_fs, MSG_SPOOL_FILE);
+  if (!file) return false;
+
+  bool success = file.seek(MSG_SPOOL_SLOT_POS(slot));
+  success = success && (file.write(&len, 1) == 1);
+  success = success && (file.write(frame, len) == len);   // rest of slot is don't-care
+  file.close();
+  return success;
+}
+
+int DataStore::readMsgSpoolSlot(uint16_t slot, uint8_t frame[]) {
+  File file = openRead(MSG_SPOOL_FILE);
+  if (!file) return 0;
+
+  uint8_t len = 0;
+  bool success = file.seek(MSG_SPOOL_SLOT_POS(slot));
+  success = success && (file.read(&len, 1) == 1) && len <= MAX_FRAME_SIZE;
+  success = success && (file.read(frame, len) == len);
+  file.close();
+  return success ? len : 0;
+}
@@ -3,6 +3,7 @@
 #include <helpers/IdentityStore.h>
 #include <helpers/ContactInfo.h>
 #include <helpers/ChannelDetails.h>
+#include <helpers/BaseSerialInterface.h>
 #include "NodePrefs.h"
 
 class DataStoreHost {
@@ -37,6 +38,10 @@ public:
   void saveChannels(DataStoreHost* host);
   uint8_t getBlobByKey(const uint8_t key[], int key_len, uint8_t dest_buf[]);
   bool putBlobByKey(const uint8_t key[], int key_len, const uint8_t src_buf[], uint8_t len);
+  bool openMsgSpool(uint16_t num_slots, uint16_t& head, uint16_t& count);
+  bool saveMsgSpoolState(uint16_t head, uint16_t count);
+  bool writeMsgSpoolSlot(uint16_t slot, const uint8_t frame[], uint8_t len);
+  int readMsgSpoolSlot(uint16_t slot, uint8_t frame[]);
   File openRead(const char* filename);
   bool removeFile(const char* filename);
   uint32_t getStorageUsedKb() const;
@@ -49,6 +49,9 @@
 // NOTE: CMD range 44..49 parked, potentially for WiFi operations
 #define CMD_SEND_BINARY_REQ           50
 #define CMD_FACTORY_RESET             51
+#define CMD_GET_CONTACTS_DELTA        52 // [epoch:4][since_seq:4][digest:4] (from last START frame, or zeroes)
+#define CMD_GET_TOPOLOGY              53 // [offset:1]
+#define CMD_SET_TOPOLOGY_SCAN         54 // [interval_secs:2], zero to disable
 
 #define RESP_CODE_OK                  0
 #define RESP_CODE_ERR                 1
@@ -74,12 +77,26 @@
 #define RESP_CODE_CUSTOM_VARS         21
 #define RESP_CODE_ADVERT_PATH         22
 #define RESP_CODE_TUNING_PARAMS       23
+#define RESP_CODE_CONTACTS_DELTA_START 24 // first reply to CMD_GET_CONTACTS_DELTA
+#define RESP_CODE_CONTACTS_BATCH      25 // multiple of these (after CMD_GET_CONTACTS_DELTA)
+#define RESP_CODE_TOPOLOGY            26 // [self_hash:1] then TopologyMap frame (reply to CMD_GET_TOPOLOGY)
+
+// RESP_CODE_CONTACTS_DELTA_START modes
+#define CONTACTS_SYNC_UNCHANGED       0  // app's list is current, no more frames follow
+#define CONTACTS_SYNC_DELTA           1  // changes/removals since app's seq follow
+#define CONTACTS_SYNC_FULL            2  // app should replace its whole list
+
+// RESP_CODE_CONTACTS_BATCH record flags
+#define CONTACT_REC_REMOVED           0x01  // just pub_key follows
+#define CONTACT_REC_HAS_LATLON        0x02
 
 #define SEND_TIMEOUT_BASE_MILLIS        500
 #define FLOOD_SEND_TIMEOUT_FACTOR       16.0f
 #define DIRECT_SEND_PERHOP_FACTOR       6.0f
 #define DIRECT_SEND_PERHOP_EXTRA_MILLIS 250
 #define LAZY_CONTACTS_WRITE_DELAY       10000  // Increased from 5s to 10s to reduce storage wear
+#define LAZY_OFFLINE_FLUSH_DELAY        30000
+#define TOPO_MIN_TRACE_INTERVAL_SECS    60
 
 #define PUBLIC_GROUP_PSK                "izOH6cXN6mrJ5e26oRXNcg=="
 
@@ -152,6 +169,82 @@ void MyMesh::writeContactRespFrame(uint8_t code, const ContactInfo &contact) {
   _serial->writeFrame(out_frame, i);
 }
 
+int MyMesh::writeCompactContact(uint8_t dest[], int max_len, const ContactInfo &contact) {
+  int path_len = contact.out_path_len > 0 ? contact.out_path_len : 0;
+  int name_len = strnlen(contact.name, sizeof(contact.name) - 1);
+  bool has_latlon = contact.gps_lat != 0 || contact.gps_lon != 0;
+  int len = 1 + PUB_KEY_SIZE + 3 + path_len + 1 + name_len + 8 + (has_latlon ? 8 : 0);
+  if (len > max_len) return 0; // doesn't fit
+
+  int i = 0;
+  dest[i++] = has_latlon ? CONTACT_REC_HAS_LATLON : 0;
+  memcpy(&dest[i], contact.id.pub_key, PUB_KEY_SIZE);
+  i += PUB_KEY_SIZE;
+  dest[i++] = contact.type;
+  dest[i++] = contact.flags;
+  dest[i++] = contact.out_path_len;
+  memcpy(&dest[i], contact.out_path, path_len);
+  i += path_len;
+  dest[i++] = name_len;
+  memcpy(&dest[i], contact.name, name_len);
+  i += name_len;
+  memcpy(&dest[i], &contact.last_advert_timestamp, 4);
+  i += 4;
+  memcpy(&dest[i], &contact.lastmod, 4);
+  i += 4;
+  if (has_latlon) {
+    memcpy(&dest[i], &contact.gps_lat, 4);
+    i += 4;
+    memcpy(&dest[i], &contact.gps_lon, 4);
+    i += 4;
+  }
+  return i;
+}
+
+void MyMesh::writeNextContactsBatch() {
+  int i = 0;
+  out_frame[i++] = RESP_CODE_CONTACTS_BATCH;
+  out_frame[i++] = 0; // num records, filled in below
+  int n = 0;
+
+  // removals first
+  while (_iter_tomb_idx < MAX_CONTACT_TOMBSTONES) {
+    auto t = getContactTombstone(_iter_tomb_idx);
+    if (t && t->change_seq > _iter_since_seq) {
+      if (i + 1 + PUB_KEY_SIZE > MAX_FRAME_SIZE) break; // frame full
+      out_frame[i++] = CONTACT_REC_REMOVED;
+      memcpy(&out_frame[i], t->pub_key, PUB_KEY_SIZE);
+      i += PUB_KEY_SIZE;
+      n++;
+    }
+    _iter_tomb_idx++;
+  }
+
+  ContactInfo contact;
+  while (_iter_tomb_idx >= MAX_CONTACT_TOMBSTONES && getContactByIdx(_iter_idx, contact)) {
+    if (contact.change_seq > _iter_since_seq) {
+      int len = writeCompactContact(&out_frame[i], MAX_FRAME_SIZE - i, contact);
+      if (len == 0) break; // frame full, send this contact in next batch
+      i += len;
+      n++;
+      if (contact.lastmod > _most_recent_lastmod) {
+        _most_recent_lastmod = contact.lastmod;
+      }
+    }
+    _iter_idx++;
+  }
+
+  if (n > 0) {
+    out_frame[1] = n;
+    _serial->writeFrame(out_frame, i);
+  } else { // EOF
+    out_frame[0] = RESP_CODE_END_OF_CONTACTS;
+    memcpy(&out_frame[1], &_most_recent_lastmod, 4);
+    _serial->writeFrame(out_frame, 5);
+    _iter_started = false;
+  }
+}
+
 void MyMesh::updateContactFromFrame(ContactInfo &contact, const uint8_t *frame, int len) {
   int i = 0;
   uint8_t code = frame[i++]; // eg. CMD_ADD_UPDATE_CONTACT
@@ -175,26 +268,24 @@ void MyMesh::updateContactFromFrame(ContactInfo &contact, const uint8_t *frame,
 }
 
 void MyMesh::addToOfflineQueue(const uint8_t frame[], int len) {
-  if (offline_queue_len >= OFFLINE_QUEUE_SIZE) {
-    MESH_DEBUG_PRINTLN("ERROR: offline_queue is full!");
-  } else {
-    offline_queue[offline_queue_len].len = len;
-    memcpy(offline_queue[offline_queue_len].buf, frame, len);
-    offline_queue_len++;
+  if (offline_queue.add(frame, len) && offline_flush_expiry == 0) {
+    offline_flush_expiry = futureMillis(LAZY_OFFLINE_FLUSH_DELAY);   // persist, if app doesn't sync soon
   }
 }
 int MyMesh::getFromOfflineQueue(uint8_t frame[]) {
-  if (offline_queue_len > 0) {         // check offline queue
-    size_t len = offline_queue[0].len; // take from top of queue
-    memcpy(frame, offline_queue[0].buf, len);
-
-    offline_queue_len--;
-    for (int i = 0; i < offline_queue_len; i++) { // delete top item from queue
-      offline_queue[i] = offline_queue[i + 1];
-    }
-    return len;
+  int len = offline_queue.get(frame);
+  if (offline_flush_expiry == 0 && offline_queue.needsFlush()) {
+    offline_flush_expiry = futureMillis(LAZY_OFFLINE_FLUSH_DELAY);   // save new spool head, lazily
   }
-  return 0; // queue is empty
+  return len;
+}
+
+void MyMesh::writeMsgWaitingFrame() {
+  uint8_t frame[3];
+  frame[0] = PUSH_CODE_MSG_WAITING; // send push 'tickle'
+  uint16_t count = offline_queue.count();
+  memcpy(&frame[1], &count, 2);     // NEW: number of frames waiting
+  _serial->writeFrame(frame, 3);
 }
 
 float MyMesh::getAirtimeBudgetFactor() const {
@@ -214,6 +305,10 @@ uint8_t MyMesh::getExtraAckTransmitCount() const {
   return _prefs.multi_acks;
 }
 
+uint32_t MyMesh::getFloodPathWindow(const mesh::Packet* packet) const {
+  return FLOOD_PATH_WINDOW_MILLIS;   // reply via best path. NOTE: companion senders allow for this in calcFloodTimeoutMillisFor()
+}
+
 void MyMesh::logRxRaw(float snr, float rssi, const uint8_t raw[], int len) {
   if (_serial->isConnected() && len + 3 <= MAX_FRAME_SIZE) {
     int i = 0;
@@ -326,16 +421,14 @@ void MyMesh::queueMessage(const ContactInfo &from, uint8_t txt_type, mesh::Packe
   addToOfflineQueue(out_frame, i);
 
   if (_serial->isConnected()) {
-    uint8_t frame[1];
-    frame[0] = PUSH_CODE_MSG_WAITING; // send push 'tickle'
-    _serial->writeFrame(frame, 1);
+    writeMsgWaitingFrame();
   }
 
 #ifdef DISPLAY_CLASS
   // we only want to show text messages on display, not cli data
   bool should_display = txt_type == TXT_TYPE_PLAIN || txt_type == TXT_TYPE_SIGNED_PLAIN;
   if (should_display) {
-    ui_task.newMsg(path_len, from.name, text, offline_queue_len);
+    ui_task.newMsg(path_len, from.name, text, offline_queue.count());
     // Always try to sound buzzer - let soundBuzzer() handle BLE connection logic
     ui_task.soundBuzzer(UIEventType::contactMessage);
   }
@@ -390,9 +483,7 @@ void MyMesh::onChannelMessageRecv(const mesh::GroupChannel &channel, mesh::Packe
   addToOfflineQueue(out_frame, i);
 
   if (_serial->isConnected()) {
-    uint8_t frame[1];
-    frame[0] = PUSH_CODE_MSG_WAITING; // send push 'tickle'
-    _serial->writeFrame(frame, 1);
+    writeMsgWaitingFrame();
   }
   
 #ifdef DISPLAY_CLASS
@@ -406,7 +497,7 @@ void MyMesh::onChannelMessageRecv(const mesh::GroupChannel &channel, mesh::Packe
   if (getChannel(channel_idx, channel_details)) {
     channel_name = channel_details.name;
   }
-  ui_task.newMsg(path_len, channel_name, text, offline_queue_len);
+  ui_task.newMsg(path_len, channel_name, text, offline_queue.count());
 #endif
 }
 
@@ -546,6 +637,12 @@ void MyMesh::onRawDataRecv(mesh::Packet *packet) {
 
 void MyMesh::onTraceRecv(mesh::Packet *packet, uint32_t tag, uint32_t auth_code, uint8_t flags,
                          const uint8_t *path_snrs, const uint8_t *path_hashes, uint8_t path_len) {
+  if (tag != 0 && (tag == topo_trace_tag || tag == app_trace_tag)) {   // is one of ours, so is out from, and back to, this node
+    topology.addTrace(self_id.pub_key[0], path_hashes, path_snrs, path_len, (int8_t)(packet->getSNR() * 4),
+                      getRTCClock()->getCurrentTime());
+    if (tag == topo_trace_tag) return;   // scheduled, app isn't expecting it
+  }
+
   int i = 0;
   out_frame[i++] = PUSH_CODE_TRACE_DATA;
   out_frame[i++] = 0; // reserved
@@ -569,7 +666,7 @@ void MyMesh::onTraceRecv(mesh::Packet *packet, uint32_t tag, uint32_t auth_code,
 }
 
 uint32_t MyMesh::calcFloodTimeoutMillisFor(uint32_t pkt_airtime_millis) const {
-  return SEND_TIMEOUT_BASE_MILLIS + (FLOOD_SEND_TIMEOUT_FACTOR * pkt_airtime_millis);
+  return SEND_TIMEOUT_BASE_MILLIS + FLOOD_PATH_WINDOW_MILLIS + (FLOOD_SEND_TIMEOUT_FACTOR * pkt_airtime_millis);
 }
 uint32_t MyMesh::calcDirectTimeoutMillisFor(uint32_t pkt_airtime_millis, uint8_t path_len) const {
   return SEND_TIMEOUT_BASE_MILLIS +
@@ -581,16 +678,23 @@ void MyMesh::onSendTimeout() {}
 
 MyMesh::MyMesh(mesh::Radio &radio, mesh::RNG &rng, mesh::RTCClock &rtc, SimpleMeshTables &tables, DataStore& store)
     : BaseChatMesh(radio, *new ArduinoMillis(), rng, rtc, *new StaticPoolPacketManager(16), tables),
-      _serial(NULL), telemetry(MAX_PACKET_PAYLOAD - 4), _store(&store) {
+      _serial(NULL), telemetry(MAX_PACKET_PAYLOAD - 4), _store(&store), offline_queue(store) {
   _iter_started = false;
+  _iter_delta = false;
+  _iter_reply_target = 0;
+  _contacts_epoch = 0;
   _cli_rescue = false;
-  offline_queue_len = 0;
   app_target_ver = 0;
   pending_login = pending_status = pending_telemetry = pending_req = 0;
   next_ack_idx = 0;
   sign_data = NULL;
   dirty_contacts_expiry = 0;
+  offline_flush_expiry = 0;
   memset(advert_paths, 0, sizeof(advert_paths));
+  topo_interval_secs = 0;
+  next_topo_trace = 0;
+  topo_next_idx = 0;
+  topo_trace_tag = app_trace_tag = 0;
 
   // defaults
   memset(&_prefs, 0, sizeof(_prefs));
@@ -608,6 +712,9 @@ MyMesh::MyMesh(mesh::Radio &radio, mesh::RNG &rng, mesh::RTCClock &rtc, SimpleMe
 void MyMesh::begin(bool has_display) {
   BaseChatMesh::begin();
 
+  // contact change seqs are only in RAM, so apps need to know when they've been reset
+  _contacts_epoch = getRNG()->nextInt(1, 0xFFFFFFFF);
+
   if (!_store->loadMainIdentity(self_id)) {
     self_id = radio_new_identity(); // create new random identity
     int count = 0;
@@ -667,6 +774,7 @@ void MyMesh::begin(bool has_display) {
   _store->loadContacts(this);
   addChannel("Public", PUBLIC_GROUP_PSK); // pre-configure Andy's public channel
   _store->loadChannels(this);
+  offline_queue.begin();   // may have messages spooled from before reboot
 
   radio_set_params(_prefs.freq, _prefs.bw, _prefs.sf, _prefs.cr);
   radio_set_tx_power(_prefs.tx_power_dbm);
@@ -831,8 +939,52 @@ void MyMesh::handleCmdFrame(size_t len) {
       // start iterator
       _iter = startContactsIterator();
       _iter_started = true;
+      _iter_delta = false;
+      _iter_reply_target = _serial->getReplyTarget();
       _most_recent_lastmod = 0;
     }
+  } else if (cmd_frame[0] == CMD_GET_CONTACTS_DELTA) {
+    if (_iter_started) {
+      writeErrFrame(ERR_CODE_BAD_STATE); // iterator is currently busy
+    } else {
+      uint32_t epoch = 0, since_seq = 0, digest = 0;
+      if (len >= 13) {
+        memcpy(&epoch, &cmd_frame[1], 4);
+        memcpy(&since_seq, &cmd_frame[5], 4);
+        memcpy(&digest, &cmd_frame[9], 4);
+      }
+
+      uint32_t curr_digest = calcContactsDigest();
+      uint32_t curr_seq = getContactsSeq();
+      uint8_t mode;
+      if (digest != 0 && digest == curr_digest) {
+        mode = CONTACTS_SYNC_UNCHANGED;
+      } else if (epoch == _contacts_epoch && since_seq > 0 && canDeltaSyncFrom(since_seq)) {
+        mode = CONTACTS_SYNC_DELTA;
+      } else {
+        mode = CONTACTS_SYNC_FULL;
+      }
+
+      int i = 0;
+      out_frame[i++] = RESP_CODE_CONTACTS_DELTA_START;
+      out_frame[i++] = mode;
+      memcpy(&out_frame[i], &_contacts_epoch, 4); i += 4;
+      memcpy(&out_frame[i], &curr_seq, 4); i += 4;       // app should save these three, for next request
+      memcpy(&out_frame[i], &curr_digest, 4); i += 4;
+      uint32_t count = getNumContacts(); // total, NOT filtered count
+      memcpy(&out_frame[i], &count, 4); i += 4;
+      _serial->writeFrame(out_frame, i);
+
+      if (mode != CONTACTS_SYNC_UNCHANGED) {  // start iterator
+        _iter_started = true;
+        _iter_delta = true;
+        _iter_reply_target = _serial->getReplyTarget();
+        _iter_since_seq = (mode == CONTACTS_SYNC_DELTA) ? since_seq : 0;
+        _iter_idx = 0;
+        _iter_tomb_idx = (mode == CONTACTS_SYNC_DELTA) ? 0 : MAX_CONTACT_TOMBSTONES;  // no removals for FULL
+        _most_recent_lastmod = 0;
+      }
+    }
   } else if (cmd_frame[0] == CMD_SET_ADVERT_NAME && len >= 2) {
     int nlen = len - 1;
     if (nlen > sizeof(_prefs.node_name) - 1) nlen = sizeof(_prefs.node_name) - 1; // max len
@@ -894,6 +1046,7 @@ void MyMesh::handleCmdFrame(size_t len) {
     if (recipient) {
       recipient->out_path_len = -1;
       // recipient->lastmod = ??   shouldn't be needed, app already has this version of contact
+      touchContact(*recipient);   // but other apps/sessions may not
       dirty_contacts_expiry = futureMillis(LAZY_CONTACTS_WRITE_DELAY);
       writeOKFrame();
     } else {
@@ -905,6 +1058,7 @@ void MyMesh::handleCmdFrame(size_t len) {
     if (recipient) {
       updateContactFromFrame(*recipient, cmd_frame, len);
       // recipient->lastmod = ??   shouldn't be needed, app already has this version of contact
+      touchContact(*recipient);   // but other apps/sessions may not
       dirty_contacts_expiry = futureMillis(LAZY_CONTACTS_WRITE_DELAY);
       writeOKFrame();
     } else {
@@ -989,7 +1143,7 @@ void MyMesh::handleCmdFrame(size_t len) {
     if ((out_len = getFromOfflineQueue(out_frame)) > 0) {
       _serial->writeFrame(out_frame, out_len);
 #ifdef DISPLAY_CLASS
-      ui_task.msgRead(offline_queue_len);
+      ui_task.msgRead(offline_queue.count());
 #endif
     } else {
       out_frame[0] = RESP_CODE_NO_MORE_MESSAGES;
@@ -1071,6 +1225,7 @@ void MyMesh::handleCmdFrame(size_t len) {
     if (dirty_contacts_expiry) { // is there are pending dirty contacts write needed?
       saveContacts();
     }
+    offline_queue.flushToSpool();
     board.reboot();
   } else if (cmd_frame[0] == CMD_GET_BATT_AND_STORAGE) {
     uint8_t reply[11];
@@ -1298,6 +1453,7 @@ void MyMesh::handleCmdFrame(size_t len) {
     memcpy(&auth, &cmd_frame[5], 4);
     auto pkt = createTrace(tag, auth, cmd_frame[9]);
     if (pkt) {
+      app_trace_tag = tag;
       uint8_t path_len = len - 10;
       sendDirect(pkt, &cmd_frame[10], path_len);
 
@@ -1375,6 +1531,19 @@ void MyMesh::handleCmdFrame(size_t len) {
     } else {
       writeErrFrame(ERR_CODE_NOT_FOUND);
     }
+  } else if (cmd_frame[0] == CMD_GET_TOPOLOGY) {
+    int i = 0;
+    out_frame[i++] = RESP_CODE_TOPOLOGY;
+    out_frame[i++] = self_id.pub_key[0];
+    i += topology.writeFrame(&out_frame[i], MAX_FRAME_SIZE - i, len >= 2 ? cmd_frame[1] : 0, getRTCClock()->getCurrentTime());
+    _serial->writeFrame(out_frame, i);
+  } else if (cmd_frame[0] == CMD_SET_TOPOLOGY_SCAN && len >= 3) {
+    uint16_t secs;
+    memcpy(&secs, &cmd_frame[1], 2);
+    if (secs > 0 && secs < TOPO_MIN_TRACE_INTERVAL_SECS) secs = TOPO_MIN_TRACE_INTERVAL_SECS;   // bound the airtime used
+    topo_interval_secs = secs;
+    next_topo_trace = secs ? futureMillis(secs * 1000) : 0;
+    writeOKFrame();
   } else if (cmd_frame[0] == CMD_FACTORY_RESET && memcmp(&cmd_frame[1], "reset", 5) == 0) {
     bool success = _store->formatFileSystem();
     if (success) {
@@ -1518,8 +1687,13 @@ void MyMesh::checkCLIRescueCmd() {
 
 void MyMesh::checkSerialInterface() {
   size_t len = _serial->checkRecvFrame(cmd_frame);
+  if (len == 0 && _iter_started) {
+    _serial->setReplyTarget(_iter_reply_target);   // other clients may have sent commands since iterator started
+  }
   if (len > 0) {
     handleCmdFrame(len);
+  } else if (_iter_started && _iter_delta && !_serial->isWriteBusy()) {
+    writeNextContactsBatch();
   } else if (_iter_started              // check if our ContactsIterator is 'running'
              && !_serial->isWriteBusy() // don't spam the Serial Interface too quickly!
   ) {
@@ -1558,11 +1732,44 @@ void MyMesh::loop() {
     dirty_contacts_expiry = 0;
   }
 
+  // unsynced messages still in RAM? move them to flash spool
+  if (offline_flush_expiry && millisHasNowPassed(offline_flush_expiry)) {
+    offline_queue.flushToSpool();
+    offline_flush_expiry = 0;
+  }
+
+  if (topo_interval_secs && millisHasNowPassed(next_topo_trace)) {
+    sendTopologyTrace();
+    next_topo_trace = futureMillis(topo_interval_secs * 1000);
+  }
+
 #ifdef DISPLAY_CLASS
   ui_task.setHasConnection(_serial->isConnected());
 #endif
 }
 
+void MyMesh::sendTopologyTrace() {
+  // round-robin over repeater contacts with a known path, tracing out to each one and back again
+  int num = getNumContacts();
+  ContactInfo c;
+  for (int k = 0; k < num; k++) {
+    uint32_t idx = topo_next_idx++ % num;
+    if (!getContactByIdx(idx, c) || c.type != ADV_TYPE_REPEATER || c.out_path_len < 0
+        || c.out_path_len*2 + 1 > MAX_PATH_SIZE) continue;
+
+    uint8_t path[MAX_PATH_SIZE];
+    int n = 0;
+    memcpy(path, c.out_path, c.out_path_len); n += c.out_path_len;
+    path[n++] = c.id.pub_key[0];
+    for (int j = c.out_path_len - 1; j >= 0; j--) path[n++] = c.out_path[j];
+
+    getRNG()->random((uint8_t *) &topo_trace_tag, 4);
+    auto pkt = createTrace(topo_trace_tag, 0, 0);
+    if (pkt) sendDirect(pkt, path, n);
+    return;
+  }
+}
+
 bool MyMesh::advert() {
   mesh::Packet* pkt;
   if (_prefs.advert_loc_policy == ADVERT_LOC_NONE) {
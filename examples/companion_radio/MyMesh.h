@@ -27,6 +27,7 @@
 
 #include "DataStore.h"
 #include "NodePrefs.h"
+#include "OfflineQueue.h"
 
 #include <RTClib.h>
 #include <helpers/ArduinoHelpers.h>
@@ -34,6 +35,7 @@
 #include <helpers/IdentityStore.h>
 #include <helpers/SimpleMeshTables.h>
 #include <helpers/StaticPoolPacketManager.h>
+#include <helpers/TopologyMap.h>
 #include <target.h>
 
 /* ---------------------------------- CONFIGURATION ------------------------------------- */
@@ -61,10 +63,6 @@
 #define MAX_CONTACTS 100
 #endif
 
-#ifndef OFFLINE_QUEUE_SIZE
-#define OFFLINE_QUEUE_SIZE 8  // Reduced from 16 to save ~2KB RAM
-#endif
-
 #ifndef BLE_NAME_PREFIX
 #define BLE_NAME_PREFIX "MeshCore-"
 #endif
@@ -99,6 +97,7 @@ protected:
   int getInterferenceThreshold() const override;
   int calcRxDelay(float score, uint32_t air_time) const override;
   uint8_t getExtraAckTransmitCount() const override;
+  uint32_t getFloodPathWindow(const mesh::Packet* packet) const override;
 
   void logRxRaw(float snr, float rssi, const uint8_t raw[], int len) override;
   bool isAutoAddEnabled() const override;
@@ -139,9 +138,12 @@ private:
   void writeErrFrame(uint8_t err_code);
   void writeDisabledFrame();
   void writeContactRespFrame(uint8_t code, const ContactInfo &contact);
+  int writeCompactContact(uint8_t dest[], int max_len, const ContactInfo &contact);
+  void writeNextContactsBatch();
   void updateContactFromFrame(ContactInfo &contact, const uint8_t *frame, int len);
   void addToOfflineQueue(const uint8_t frame[], int len);
   int getFromOfflineQueue(uint8_t frame[]);
+  void writeMsgWaitingFrame();
   int getBlobByKey(const uint8_t key[], int key_len, uint8_t dest_buf[]) override { 
     return _store->getBlobByKey(key, key_len, dest_buf);
   }
@@ -151,6 +153,7 @@ private:
 
   void checkCLIRescueCmd();
   void checkSerialInterface();
+  void sendTopologyTrace();
 
   // helpers, short-cuts
   void savePrefs() { _store->savePrefs(_prefs, sensors.node_lat, sensors.node_lon); }
@@ -169,6 +172,12 @@ private:
   ContactsIterator _iter;
   uint32_t _iter_filter_since;
   uint32_t _most_recent_lastmod;
+  bool _iter_delta;           // iterating for CMD_GET_CONTACTS_DELTA
+  uint32_t _iter_since_seq;
+  uint32_t _iter_idx;
+  int _iter_tomb_idx;
+  int _iter_reply_target;     // client (of multi-client serial interface) which the contacts go to
+  uint32_t _contacts_epoch;
   uint32_t _active_ble_pin;
   bool _iter_started;
   bool _cli_rescue;
@@ -177,17 +186,20 @@ private:
   uint8_t *sign_data;
   uint32_t sign_data_len;
   unsigned long dirty_contacts_expiry;
+  unsigned long offline_flush_expiry;
 
   uint8_t cmd_frame[MAX_FRAME_SIZE + 1];
   uint8_t out_frame[MAX_FRAME_SIZE + 1];
   CayenneLPP telemetry;
 
-  struct Frame {
-    uint8_t len;
-    uint8_t buf[MAX_FRAME_SIZE];
-  };
-  int offline_queue_len;
-  Frame offline_queue[OFFLINE_QUEUE_SIZE];
+  OfflineQueue offline_queue;
+
+  TopologyMap topology;
+  uint16_t topo_interval_secs;   // zero if scheduled traces are disabled
+  unsigned long next_topo_trace;
+  uint32_t topo_next_idx;        // round-robin contact index
+  uint32_t topo_trace_tag;       // of last scheduled trace
+  uint32_t app_trace_tag;        // of last CMD_SEND_TRACE_PATH
 
   struct AckTableEntry {
     unsigned long msg_sent;
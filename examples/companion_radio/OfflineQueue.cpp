@@ -0,0 +1,72 @@
+#include "OfflineQueue.h"
+
+#include <Mesh.h>
+
+void OfflineQueue::begin() {
+  _has_spool = _store->openMsgSpool(OFFLINE_SPOOL_SIZE, _spool_head, _spool_count);
+  if (!_has_spool) {
+    MESH_DEBUG_PRINTLN("ERROR: unable to open offline spool, RAM queue only");
+    _spool_head = _spool_count = 0;
+  }
+}
+
+bool OfflineQueue::add(const uint8_t frame[], int len) {
+  if (_spool_count == 0 && _ram_count < OFFLINE_QUEUE_SIZE) {  // fast path, RAM only
+    Frame* f = &_ram[(_ram_head + _ram_count) % OFFLINE_QUEUE_SIZE];
+    f->len = len;
+    memcpy(f->buf, frame, len);
+    _ram_count++;
+    return true;
+  }
+
+  // RAM is full, or older frames are already in spool (preserve FIFO order)
+  if (!_has_spool || _spool_count >= OFFLINE_SPOOL_SIZE) {
+    MESH_DEBUG_PRINTLN("ERROR: offline_queue is full!");
+    return false;
+  }
+  uint16_t slot = (_spool_head + _spool_count) % OFFLINE_SPOOL_SIZE;
+  if (!_store->writeMsgSpoolSlot(slot, frame, len)) {
+    MESH_DEBUG_PRINTLN("ERROR: offline spool write failed");
+    return false;
+  }
+  _spool_count++;
+  _spool_dirty = true;
+  return true;
+}
+
+int OfflineQueue::get(uint8_t frame[]) {
+  if (_ram_count > 0) {     // RAM frames are always the oldest
+    Frame* f = &_ram[_ram_head];
+    memcpy(frame, f->buf, f->len);
+    _ram_head = (_ram_head + 1) % OFFLINE_QUEUE_SIZE;
+    _ram_count--;
+    return f->len;
+  }
+  while (_spool_count > 0) {
+    int len = _store->readMsgSpoolSlot(_spool_head, frame);
+    _spool_head = (_spool_head + 1) % OFFLINE_SPOOL_SIZE;
+    _spool_count--;
+    _spool_dirty = true;
+    if (len > 0) return len;
+    // else, unreadable slot, just skip it
+  }
+  return 0; // queue is empty
+}
+
+void OfflineQueue::flushToSpool() {
+  if (!_has_spool || !needsFlush()) return;
+
+  // push newest RAM frame first, onto the FRONT of the spool ring
+  while (_ram_count > 0 && _spool_count < OFFLINE_SPOOL_SIZE) {
+    Frame* f = &_ram[(_ram_head + _ram_count - 1) % OFFLINE_QUEUE_SIZE];
+    uint16_t slot = (_spool_head + OFFLINE_SPOOL_SIZE - 1) % OFFLINE_SPOOL_SIZE;
+    if (!_store->writeMsgSpoolSlot(slot, f->buf, f->len)) break;
+
+    _spool_head = slot;
+    _spool_count++;
+    _ram_count--;
+  }
+  if (_store->saveMsgSpoolState(_spool_head, _spool_count)) {
+    _spool_dirty = false;
+  }
+}
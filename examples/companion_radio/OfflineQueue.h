@@ -0,0 +1,60 @@
+#pragma once
+
+#include <Arduino.h>
+#include <helpers/BaseSerialInterface.h>
+#include "DataStore.h"
+
+#ifndef OFFLINE_QUEUE_SIZE
+#define OFFLINE_QUEUE_SIZE 8  // Reduced from 16 to save ~2KB RAM
+#endif
+
+#ifndef OFFLINE_SPOOL_SIZE    // number of frames that can overflow to the flash spool file
+  #if defined(ESP32)
+    #define OFFLINE_SPOOL_SIZE  1024
+  #elif defined(RP2040_PLATFORM)
+    #define OFFLINE_SPOOL_SIZE  256
+  #else
+    #define OFFLINE_SPOOL_SIZE  32    // InternalFS is small on NRF52/STM32
+  #endif
+#endif
+
+/**
+ * \brief  FIFO of frames waiting for the app (CMD_SYNC_NEXT_MESSAGE). A small RAM ring holds the oldest
+ *         frames, and anything beyond that overflows to a pre-allocated ring file in flash.
+ *         Invariant: while the spool is non-empty, every RAM frame is older than every spooled frame.
+*/
+class OfflineQueue {
+  struct Frame {
+    uint8_t len;
+    uint8_t buf[MAX_FRAME_SIZE];
+  };
+  DataStore* _store;
+  Frame _ram[OFFLINE_QUEUE_SIZE];
+  uint16_t _ram_head, _ram_count;
+  uint16_t _spool_head, _spool_count;
+  bool _has_spool;
+  bool _spool_dirty;    // spool head/count changed since last saved (saved lazily, to spread flash wear)
+
+public:
+  OfflineQueue(DataStore& store) : _store(&store) {
+    _ram_head = _ram_count = 0;
+    _spool_head = _spool_count = 0;
+    _has_spool = false;
+    _spool_dirty = false;
+  }
+
+  void begin();   // opens (or pre-allocates) the spool, and restores frames from before a reboot
+
+  bool add(const uint8_t frame[], int len);
+  int get(uint8_t frame[]);
+  int count() const { return _ram_count + _spool_count; }
+
+  /** \brief  true if there are frames or spool changes which flushToSpool() needs to persist */
+  bool needsFlush() const { return _ram_count > 0 || _spool_dirty; }
+
+  /**
+   * \brief  moves frames still in RAM to the front of the spool, and saves spool head/count, so they survive a reboot/power loss.
+   *        NOTE: frames taken from the spool since last flush can be delivered again after a power loss
+  */
+  void flushToSpool();
+};
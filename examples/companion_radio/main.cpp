@@ -89,6 +89,12 @@ void halt() {
   while (1) ;
 }
 
+#ifdef DISPLAY_CLASS
+static void onDisplayBusy(void* ctx) {
+  the_mesh.loop();   // keep servicing the radio while a (e-paper) panel refresh is in progress
+}
+#endif
+
 void setup() {
   Serial.begin(115200);
 
@@ -186,6 +192,7 @@ void setup() {
   sensors.begin();
 
 #ifdef DISPLAY_CLASS
+  if (disp) disp->setBusyCallback(onDisplayBusy, NULL);
   ui_task.begin(disp, &sensors, the_mesh.getNodePrefs());  // still want to pass this in as dependency, as prefs might be moved
 #endif
 }
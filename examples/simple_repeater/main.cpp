@@ -16,6 +16,8 @@
 #include <helpers/AdvertDataHelpers.h>
 #include <helpers/TxtDataHelpers.h>
 #include <helpers/CommonCLI.h>
+#include <helpers/sensors/TelemetrySubscriptions.h>
+#include <helpers/TxPowerControl.h>
 #include <RTClib.h>
 #include <target.h>
 
@@ -67,6 +69,10 @@
   #define TXT_ACK_DELAY     200
 #endif
 
+#ifndef TELEM_PUSH_CHECK_SECS
+  #define TELEM_PUSH_CHECK_SECS   60   // how often sensors are read, when there are any subscriptions
+#endif
+
 #ifdef DISPLAY_CLASS
   #include "UITask.h"
   static UITask ui_task(display);
@@ -81,6 +87,11 @@
 #define REQ_TYPE_GET_STATUS          0x01   // same as _GET_STATS
 #define REQ_TYPE_KEEP_ALIVE          0x02
 #define REQ_TYPE_GET_TELEMETRY_DATA  0x03
+#define REQ_TYPE_CONFIG              0x06   // binary multi get/set of settings (see CommonCLI)
+#define REQ_TYPE_SUBSCRIBE           0x08   // register telemetry push rule (see TelemetrySubscriptions)
+
+#define SUBSCRIBE_OK                 0
+#define SUBSCRIBE_ERR_FULL           1
 
 #define RESP_SERVER_LOGIN_OK      0   // response to ANON_REQ
 
@@ -120,6 +131,10 @@ struct NeighbourInfo {
   int8_t snr; // multiplied by 4, user should divide to get float value
 };
 
+#ifndef POWER_SAVING_SLEEP_MILLIS
+  #define POWER_SAVING_SLEEP_MILLIS   1000
+#endif
+
 #define CLI_REPLY_DELAY_MILLIS  600
 
 class MyMesh : public mesh::Mesh, public CommonCLICallbacks {
@@ -134,6 +149,9 @@ class MyMesh : public mesh::Mesh, public CommonCLICallbacks {
   NeighbourInfo neighbours[MAX_NEIGHBOURS];
 #endif
   CayenneLPP telemetry;
+  TxPowerControl tpc;
+  TelemetrySubscriptions subscriptions;
+  unsigned long next_telem_check;
   unsigned long set_radio_at, revert_radio_at;
   float pending_freq;
   float pending_bw;
@@ -223,10 +241,75 @@ class MyMesh : public mesh::Mesh, public CommonCLICallbacks {
         memcpy(&reply_data[4], telemetry.getBuffer(), tlen);
         return 4 + tlen;  // reply_len
       }
+      case REQ_TYPE_CONFIG: {
+        if (!(sender->is_admin)) break;
+
+        int len = _cli.handleConfigRequest(&payload[1], payload_len - 1, &reply_data[4], sizeof(reply_data) - 4);
+        return len > 0 ? 4 + len : 0;
+      }
+      case REQ_TYPE_SUBSCRIBE: {
+        if (!(sender->is_admin) || payload_len < 15) break;
+
+        // req: [push_tag(4)] [channel] [lpp_type] [deadband(float)] [min_secs(2)] [max_secs(2)]   channel=0 to unsubscribe all
+        uint32_t push_tag;
+        float deadband;
+        uint16_t min_secs, max_secs;
+        memcpy(&push_tag, &payload[1], 4);
+        memcpy(&deadband, &payload[7], 4);
+        memcpy(&min_secs, &payload[11], 2);
+        memcpy(&max_secs, &payload[13], 2);
+
+        uint8_t status = SUBSCRIBE_OK;
+        if (payload[5] == 0) {
+          subscriptions.unsubscribe(sender->id.pub_key);
+        } else if (!subscriptions.subscribe(sender->id.pub_key, push_tag, payload[5], payload[6], deadband, min_secs, max_secs)) {
+          status = SUBSCRIBE_ERR_FULL;
+        }
+        if (!subscriptions.isEmpty() && next_telem_check == 0) next_telem_check = futureMillis(1000);
+
+        reply_data[4] = status;
+        reply_data[5] = subscriptions.count(sender->id.pub_key);
+        return 6;
+      }
     }
     return 0;  // unknown command
   }
 
+  ClientInfo* findClient(const uint8_t* key, int key_len) {
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+      if (memcmp(known_clients[i].id.pub_key, key, key_len) == 0) return &known_clients[i];
+    }
+    return NULL;
+  }
+
+  void pushTelemetry() {
+    telemetry.reset();
+    telemetry.addVoltage(TELEM_CHANNEL_SELF, (float)board.getBattMilliVolts() / 1000.0f);
+    sensors.querySensors(0xFF, telemetry);   // subscribers are all admins
+
+    uint8_t key[TELEM_SUB_KEY_SIZE];
+    uint32_t tag;
+    int len;
+    // push: [tag(4)] [lpp records]  (as a RESPONSE, so subscriber can match it like a GET_TELEMETRY_DATA reply)
+    while ((len = subscriptions.nextPush(getRTCClock()->getCurrentTime(), telemetry.getBuffer(), telemetry.getSize(),
+                                         key, tag, &reply_data[4], sizeof(reply_data) - 4)) > 0) {
+      ClientInfo* client = findClient(key, TELEM_SUB_KEY_SIZE);
+      if (client == NULL || !client->is_admin) {   // client has since been evicted from known_clients
+        subscriptions.unsubscribe(key);
+        continue;
+      }
+      memcpy(reply_data, &tag, 4);
+      mesh::Packet* pkt = createDatagram(PAYLOAD_TYPE_RESPONSE, client->id, client->secret, reply_data, 4 + len);
+      if (pkt) {
+        if (client->out_path_len >= 0) {  // we have an out_path, so send DIRECT
+          sendDirect(pkt, client->out_path, client->out_path_len, SERVER_RESPONSE_DELAY);
+        } else {
+          sendFlood(pkt, SERVER_RESPONSE_DELAY);
+        }
+      }
+    }
+  }
+
   mesh::Packet* createSelfAdvert() {
     uint8_t app_data[MAX_ADVERT_DATA_SIZE];
     uint8_t app_data_len;
@@ -344,6 +427,14 @@ protected:
   int getAGCResetInterval() const override {
     return ((int)_prefs.agc_reset_interval) * 4000;   // milliseconds
   }
+  uint8_t getTxPowerFor(const mesh::Packet* packet) override {
+    return tpc.getPowerFor(packet, _prefs.tx_power_dbm, _prefs.sf, _prefs.tpc_margin, getRTCClock()->getCurrentTime());
+  }
+
+  mesh::DispatcherAction onRecvPacket(mesh::Packet* pkt) override {
+    tpc.onRecv(pkt, self_id.pub_key[0], getRTCClock()->getCurrentTime());   // track link quality of neighbours
+    return mesh::Mesh::onRecvPacket(pkt);
+  }
   uint8_t getExtraAckTransmitCount() const override {
     return _prefs.multi_acks;
   }
@@ -409,14 +500,18 @@ protected:
   }
 
   int  matching_peer_indexes[MAX_CLIENTS];
+  uint32_t matching_peer_ranks[MAX_CLIENTS];
 
-  int searchPeersByHash(const uint8_t* hash) override {
+  int searchPeersByHash(const uint8_t* hash, const mesh::Packet* packet) override {
     int n = 0;
     for (int i = 0; i < MAX_CLIENTS; i++) {
-      if (known_clients[i].id.isHashMatch(hash)) {
+      auto c = &known_clients[i];
+      if (c->id.isHashMatch(hash)) {
+        matching_peer_ranks[n] = calcPeerRank(isReturnPath(packet, c->out_path, c->out_path_len), c->last_activity);
         matching_peer_indexes[n++] = i;  // store the INDEXES of matching contacts (for subsequent 'peer' methods)
       }
     }
+    sortPeerCandidates(matching_peer_indexes, matching_peer_ranks, n);
     return n;
   }
 
@@ -564,6 +659,7 @@ public:
     memset(known_clients, 0, sizeof(known_clients));
     next_local_advert = next_flood_advert = 0;
     set_radio_at = revert_radio_at = 0;
+    next_telem_check = 0;
     _logging = false;
 
   #if MAX_NEIGHBOURS
@@ -598,6 +694,8 @@ public:
 
     radio_set_params(_prefs.freq, _prefs.bw, _prefs.sf, _prefs.cr);
     radio_set_tx_power(_prefs.tx_power_dbm);
+    tpc.setCurrentPower(_prefs.tx_power_dbm);
+    _radio->setRxDutyCycle(_prefs.power_saving);
 
     updateAdvertTimer();
     updateFloodAdvertTimer();
@@ -615,6 +713,25 @@ public:
     _cli.savePrefs(_fs);
   }
 
+  void setPowerSaving(bool enable) override {
+    _radio->setRxDutyCycle(enable);
+  }
+
+  /**
+   * \returns  how long main loop can sleep for (until radio interrupt, or the next timer), zero if not now
+  */
+  uint32_t getSleepMillis() {
+    if (!_prefs.power_saving || !_radio->isSleepAllowed() || Serial.available()) return 0;
+
+    uint32_t ms = getIdleMillis(POWER_SAVING_SLEEP_MILLIS);
+    if (next_flood_advert) ms = millisUntil(next_flood_advert, ms);
+    if (next_local_advert) ms = millisUntil(next_local_advert, ms);
+    if (set_radio_at) ms = millisUntil(set_radio_at, ms);
+    if (revert_radio_at) ms = millisUntil(revert_radio_at, ms);
+    if (next_telem_check) ms = millisUntil(next_telem_check, ms);
+    return ms;
+  }
+
   void applyTempRadioParams(float freq, float bw, uint8_t sf, uint8_t cr, int timeout_mins) override {
     set_radio_at = futureMillis(2000);   // give CLI reply some time to be sent back, before applying temp radio params
     pending_freq = freq;
@@ -686,6 +803,7 @@ public:
 
   void setTxPower(uint8_t power_dbm) override {
     radio_set_tx_power(power_dbm);
+    tpc.setCurrentPower(power_dbm);
   }
 
   void formatNeighborsReply(char *reply) override {
@@ -763,6 +881,15 @@ public:
       MESH_DEBUG_PRINTLN("Radio params restored");
     }
 
+    if (next_telem_check && millisHasNowPassed(next_telem_check)) {
+      if (subscriptions.isEmpty()) {
+        next_telem_check = 0;   // stop reading sensors until someone subscribes again
+      } else {
+        pushTelemetry();
+        next_telem_check = futureMillis(TELEM_PUSH_CHECK_SECS * 1000);
+      }
+    }
+
   #ifdef DISPLAY_CLASS
     ui_task.loop();
   #endif
@@ -869,4 +996,9 @@ void loop() {
 
   the_mesh.loop();
   sensors.loop();
+
+  uint32_t sleep_millis = the_mesh.getSleepMillis();
+  if (sleep_millis > 0) {
+    board.sleep(sleep_millis);   // wakes early on radio interrupt
+  }
 }
@@ -16,6 +16,7 @@
 #include <helpers/AdvertDataHelpers.h>
 #include <helpers/TxtDataHelpers.h>
 #include <helpers/CommonCLI.h>
+#include <helpers/TxPowerControl.h>
 #include <RTClib.h>
 #include <target.h>
 
@@ -75,6 +76,10 @@
   #define TXT_ACK_DELAY     200
 #endif
 
+#ifndef POWER_SAVING_SLEEP_MILLIS
+  #define POWER_SAVING_SLEEP_MILLIS   1000
+#endif
+
 #ifdef DISPLAY_CLASS
   #include "UITask.h"
   static UITask ui_task(display);
@@ -130,6 +135,7 @@ struct PostInfo {
 #define REQ_TYPE_GET_STATUS          0x01   // same as _GET_STATS
 #define REQ_TYPE_KEEP_ALIVE          0x02
 #define REQ_TYPE_GET_TELEMETRY_DATA  0x03
+#define REQ_TYPE_CONFIG              0x06   // binary multi get/set of settings (see CommonCLI)
 
 #define RESP_SERVER_LOGIN_OK      0   // response to ANON_REQ
 
@@ -165,6 +171,7 @@ class MyMesh : public mesh::Mesh, public CommonCLICallbacks {
   int next_post_idx;
   PostInfo posts[MAX_UNSYNCED_POSTS];   // cyclic queue
   CayenneLPP telemetry;
+  TxPowerControl tpc;
   unsigned long set_radio_at, revert_radio_at;
   float pending_freq;
   float pending_bw;
@@ -335,6 +342,12 @@ class MyMesh : public mesh::Mesh, public CommonCLICallbacks {
         memcpy(&reply_data[4], telemetry.getBuffer(), tlen);
         return 4 + tlen;  // reply_len
       }
+      case REQ_TYPE_CONFIG: {
+        if (!(sender->permission == RoomPermission::ADMIN)) break;
+
+        int len = _cli.handleConfigRequest(&payload[1], payload_len - 1, &reply_data[4], sizeof(reply_data) - 4);
+        return len > 0 ? 4 + len : 0;
+      }
     }
     return 0;  // unknown command
   }
@@ -429,6 +442,14 @@ protected:
   int getAGCResetInterval() const override {
     return ((int)_prefs.agc_reset_interval) * 4000;   // milliseconds
   }
+  uint8_t getTxPowerFor(const mesh::Packet* packet) override {
+    return tpc.getPowerFor(packet, _prefs.tx_power_dbm, _prefs.sf, _prefs.tpc_margin, getRTCClock()->getCurrentTime());
+  }
+
+  mesh::DispatcherAction onRecvPacket(mesh::Packet* pkt) override {
+    tpc.onRecv(pkt, self_id.pub_key[0], getRTCClock()->getCurrentTime());   // track link quality of neighbours
+    return mesh::Mesh::onRecvPacket(pkt);
+  }
   uint8_t getExtraAckTransmitCount() const override {
     return _prefs.multi_acks;
   }
@@ -507,14 +528,18 @@ protected:
   }
 
   int  matching_peer_indexes[MAX_CLIENTS];
+  uint32_t matching_peer_ranks[MAX_CLIENTS];
 
-  int searchPeersByHash(const uint8_t* hash) override {
+  int searchPeersByHash(const uint8_t* hash, const mesh::Packet* packet) override {
     int n = 0;
     for (int i = 0; i < num_clients; i++) {
-      if (known_clients[i].id.isHashMatch(hash)) {
+      auto c = &known_clients[i];
+      if (c->id.isHashMatch(hash)) {
+        matching_peer_ranks[n] = calcPeerRank(isReturnPath(packet, c->out_path, c->out_path_len), c->last_activity);
         matching_peer_indexes[n++] = i;  // store the INDEXES of matching contacts (for subsequent 'peer' methods)
       }
     }
+    sortPeerCandidates(matching_peer_indexes, matching_peer_ranks, n);
     return n;
   }
 
@@ -767,6 +792,8 @@ public:
 
     radio_set_params(_prefs.freq, _prefs.bw, _prefs.sf, _prefs.cr);
     radio_set_tx_power(_prefs.tx_power_dbm);
+    tpc.setCurrentPower(_prefs.tx_power_dbm);
+    _radio->setRxDutyCycle(_prefs.power_saving);
 
     updateAdvertTimer();
     updateFloodAdvertTimer();
@@ -784,6 +811,25 @@ public:
     _cli.savePrefs(_fs);
   }
 
+  void setPowerSaving(bool enable) override {
+    _radio->setRxDutyCycle(enable);
+  }
+
+  /**
+   * \returns  how long main loop can sleep for (until radio interrupt, or the next timer), zero if not now
+  */
+  uint32_t getSleepMillis() {
+    if (!_prefs.power_saving || !_radio->isSleepAllowed() || Serial.available()) return 0;
+
+    uint32_t ms = getIdleMillis(POWER_SAVING_SLEEP_MILLIS);
+    if (num_clients > 0) ms = millisUntil(next_push, ms);   // post sync to clients
+    if (next_flood_advert) ms = millisUntil(next_flood_advert, ms);
+    if (next_local_advert) ms = millisUntil(next_local_advert, ms);
+    if (set_radio_at) ms = millisUntil(set_radio_at, ms);
+    if (revert_radio_at) ms = millisUntil(revert_radio_at, ms);
+    return ms;
+  }
+
   void applyTempRadioParams(float freq, float bw, uint8_t sf, uint8_t cr, int timeout_mins) override {
     set_radio_at = futureMillis(2000);   // give CLI reply some time to be sent back, before applying temp radio params
     pending_freq = freq;
@@ -855,6 +901,7 @@ public:
 
   void setTxPower(uint8_t power_dbm) override {
     radio_set_tx_power(power_dbm);
+    tpc.setCurrentPower(power_dbm);
   }
 
   void formatNeighborsReply(char *reply) override {
@@ -1056,4 +1103,9 @@ void loop() {
 
   the_mesh.loop();
   sensors.loop();
+
+  uint32_t sleep_millis = the_mesh.getSleepMillis();
+  if (sleep_millis > 0) {
+    board.sleep(sleep_millis);   // wakes early on radio interrupt
+  }
 }
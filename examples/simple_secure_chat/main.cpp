@@ -262,8 +262,12 @@ protected:
     // not supported
   }
 
+  uint32_t getFloodPathWindow(const mesh::Packet* packet) const override {
+    return FLOOD_PATH_WINDOW_MILLIS;   // reply via best path (senders allow for this in calcFloodTimeoutMillisFor())
+  }
+
   uint32_t calcFloodTimeoutMillisFor(uint32_t pkt_airtime_millis) const override {
-    return SEND_TIMEOUT_BASE_MILLIS + (FLOOD_SEND_TIMEOUT_FACTOR * pkt_airtime_millis);
+    return SEND_TIMEOUT_BASE_MILLIS + FLOOD_PATH_WINDOW_MILLIS + (FLOOD_SEND_TIMEOUT_FACTOR * pkt_airtime_millis);
   }
   uint32_t calcDirectTimeoutMillisFor(uint32_t pkt_airtime_millis, uint8_t path_len) const override {
     return SEND_TIMEOUT_BASE_MILLIS + 
@@ -1,4 +1,5 @@
 #include "SensorMesh.h"
+#include <helpers/sensors/LPPDataHelpers.h>
 
 /* ------------------------------ Config -------------------------------- */
 
@@ -52,6 +53,9 @@
 #define REQ_TYPE_GET_TELEMETRY_DATA  0x03
 #define REQ_TYPE_GET_AVG_MIN_MAX     0x04
 #define REQ_TYPE_GET_ACCESS_LIST     0x05
+#define REQ_TYPE_CONFIG              0x06   // binary multi get/set of settings (see CommonCLI)
+#define REQ_TYPE_GET_SERIES_RAW      0x07
+#define REQ_TYPE_SUBSCRIBE           0x08   // register telemetry push rule (see TelemetrySubscriptions)
 
 #define RESP_SERVER_LOGIN_OK      0   // response to ANON_REQ
 
@@ -59,7 +63,14 @@
 
 #define LAZY_CONTACTS_WRITE_DELAY       5000
 
-#define ALERT_ACK_EXPIRY_MILLIS         8000   // wait 8 secs for ACKs to alert messages
+#define ALERT_ACK_EXPIRY_MILLIS         8000   // wait 8 secs for ACKs to alert messages (doubles on each retry)
+#define ALERT_RETRY_JITTER_MILLIS       2000
+
+#define MAX_SERIES_RAW_SAMPLES           128   // max samples fetched per REQ_TYPE_GET_SERIES_RAW
+#define SERIES_RAW_FLAG_MORE            0x01   // more samples after this reply (resume from next_time)
+
+#define SUBSCRIBE_OK                       0
+#define SUBSCRIBE_ERR_FULL                 1
 
 static File openAppend(FILESYSTEM* _fs, const char* fname) {
   #if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
@@ -143,104 +154,60 @@ void SensorMesh::saveContacts() {
   }
 }
 
-static uint8_t getDataSize(uint8_t type) {
-    switch (type) {
-      case LPP_GPS:
-        return 9;
-      case LPP_POLYLINE:
-        return 8;  // TODO: this is MINIMIUM
-      case LPP_GYROMETER:
-      case LPP_ACCELEROMETER:
-        return 6;
-      case LPP_GENERIC_SENSOR:
-      case LPP_FREQUENCY:
-      case LPP_DISTANCE:
-      case LPP_ENERGY:
-      case LPP_UNIXTIME:
-        return 4;
-      case LPP_COLOUR:
-        return 3;
-      case LPP_ANALOG_INPUT:
-      case LPP_ANALOG_OUTPUT:
-      case LPP_LUMINOSITY:
-      case LPP_TEMPERATURE:
-      case LPP_CONCENTRATION:
-      case LPP_BAROMETRIC_PRESSURE:
-      case LPP_RELATIVE_HUMIDITY:
-      case LPP_ALTITUDE:
-      case LPP_VOLTAGE:
-      case LPP_CURRENT:
-      case LPP_DIRECTION:
-      case LPP_POWER:
-        return 2;
-    }
-    return 1;
-}
-
-static uint32_t getMultiplier(uint8_t type) {
-    switch (type) {
-      case LPP_CURRENT:
-      case LPP_DISTANCE:
-      case LPP_ENERGY:
-        return 1000;
-      case LPP_VOLTAGE:
-      case LPP_ANALOG_INPUT:
-      case LPP_ANALOG_OUTPUT:
-        return 100;
-      case LPP_TEMPERATURE:
-      case LPP_BAROMETRIC_PRESSURE:
-      case LPP_RELATIVE_HUMIDITY:
-        return 10;
-    }
-    return 1;
-}
-
-static bool isSigned(uint8_t type) {
-  return type == LPP_ALTITUDE || type == LPP_TEMPERATURE || type == LPP_GYROMETER ||
-      type == LPP_ANALOG_INPUT || type == LPP_ANALOG_OUTPUT || type == LPP_GPS || type == LPP_ACCELEROMETER;
-}
-
-static float getFloat(const uint8_t * buffer, uint8_t size, uint32_t multiplier, bool is_signed) {
-  uint32_t value = 0;
-  for (uint8_t i = 0; i < size; i++) {
-    value = (value << 8) + buffer[i];
-  }
-
-  int sign = 1;
-  if (is_signed) {
-    uint32_t bit = 1ul << ((size * 8) - 1);
-    if ((value & bit) == bit) {
-      value = (bit << 1) - value;
-      sign = -1;
+/*
+ * Raw series encoding. Values are quantised to the LPP type's precision, then each sample is coded as the
+ * delta from the previous one (zigzag), using prefix codes sized for slowly changing readings:
+ *   0                    same as previous
+ *   10    + 6 bits       small delta
+ *   110   + 10 bits      medium delta
+ *   1110  + 16 bits      large delta
+ *   11110 + 32 bits      absolute value  (becomes new 'previous')
+ *   11111                no sample (gap)
+ * The initial 'previous' is zero. Bits are packed MSB first.
+*/
+class BitWriter {
+  uint8_t* _dest;
+  int _max_bits, _bits;
+public:
+  BitWriter(uint8_t* dest, int max_bytes) : _dest(dest), _max_bits(max_bytes * 8), _bits(0) { memset(dest, 0, max_bytes); }
+
+  int bitsLeft() const { return _max_bits - _bits; }
+  int getBytes() const { return (_bits + 7) / 8; }
+
+  void write(uint32_t v, int nbits) {
+    while (nbits > 0) {
+      nbits--;
+      if ((v >> nbits) & 1) _dest[_bits / 8] |= 0x80 >> (_bits % 8);
+      _bits++;
     }
   }
-  return sign * ((float) value / multiplier);
-}
-
-static uint8_t putFloat(uint8_t * dest, float value, uint8_t size, uint32_t multiplier, bool is_signed) {
-  // check sign
-  bool sign = value < 0;
-  if (sign) value = -value;
+};
 
-  // get value to store
-  uint32_t v = value * multiplier;
+#define SERIES_MAX_CODE_BITS   37
 
-  // format an uint32_t as if it was an int32_t
-  if (is_signed & sign) {
-    uint32_t mask = (1 << (size * 8)) - 1;
-    v = v & mask;
-    if (sign) v = mask - v + 1;
+static void encodeSample(BitWriter& out, float v, uint32_t multiplier, int32_t& prev) {
+  if (isnan(v)) {
+    out.write(0x1F, 5);
+    return;
   }
-
-  // add bytes (MSB first)
-  for (uint8_t i=1; i<=size; i++) {
-    dest[size - i] = (v & 0xFF);
-    v >>= 8;
+  int32_t q = (int32_t) lroundf(v * multiplier);
+  int32_t delta = q - prev;
+  uint32_t zz = (((uint32_t) delta) << 1) ^ (uint32_t)(delta >> 31);   // zigzag
+  if (zz == 0) {
+    out.write(0, 1);
+  } else if (zz < (1 << 6)) {
+    out.write(0x2, 2); out.write(zz, 6);
+  } else if (zz < (1 << 10)) {
+    out.write(0x6, 3); out.write(zz, 10);
+  } else if (zz < (1UL << 16)) {
+    out.write(0xE, 4); out.write(zz, 16);
+  } else {
+    out.write(0x1E, 5); out.write((uint32_t) q, 32);
   }
-  return size;
+  prev = q;
 }
 
-uint8_t SensorMesh::handleRequest(uint8_t perms, uint32_t sender_timestamp, uint8_t req_type, uint8_t* payload, size_t payload_len) {
+uint8_t SensorMesh::handleRequest(const uint8_t* sender_key, uint8_t perms, uint32_t sender_timestamp, uint8_t req_type, uint8_t* payload, size_t payload_len) {
   memcpy(reply_data, &sender_timestamp, 4);   // reflect sender_timestamp back in response packet (kind of like a 'tag')
 
   if (req_type == REQ_TYPE_GET_TELEMETRY_DATA) {  // allow all
@@ -302,6 +269,58 @@ uint8_t SensorMesh::handleRequest(uint8_t perms, uint32_t sender_timestamp, uint
       return ofs;
     }
   }
+  if (req_type == REQ_TYPE_GET_SERIES_RAW && payload_len >= 6 && (perms & PERM_ACL_ROLE_MASK) >= PERM_ACL_READ_ONLY) {
+    uint8_t channel = payload[0];
+    uint8_t lpp_type = payload[1];
+    uint32_t from_time;
+    memcpy(&from_time, &payload[2], 4);   // cursor, ie. 'next_time' from previous reply (or zero for all)
+
+    float samples[MAX_SERIES_RAW_SAMPLES + 1];   // one extra, to peek whether more remain
+    uint32_t first_time = 0, interval = 0;
+    int n = querySeriesRaw(channel, lpp_type, from_time, first_time, interval, samples, MAX_SERIES_RAW_SAMPLES + 1);
+
+    // reply: [tag(4)] [first_time(4)] [interval_secs(2)] [count] [flags] [encoded bits]
+    uint8_t ofs = 4;
+    memcpy(&reply_data[ofs], &first_time, 4); ofs += 4;
+    uint16_t interval16 = interval;
+    memcpy(&reply_data[ofs], &interval16, 2); ofs += 2;
+    uint8_t* count_flags = &reply_data[ofs]; ofs += 2;
+
+    BitWriter out(&reply_data[ofs], sizeof(reply_data) - ofs);
+    uint32_t mult = getMultiplier(lpp_type);
+    int32_t prev = 0;
+    int i = 0;
+    while (i < n && i < MAX_SERIES_RAW_SAMPLES && i < 255 && out.bitsLeft() >= SERIES_MAX_CODE_BITS) {
+      encodeSample(out, samples[i++], mult, prev);
+    }
+    count_flags[0] = i;
+    count_flags[1] = i < n ? SERIES_RAW_FLAG_MORE : 0;   // requester should resume from first_time + count*interval
+    return ofs + out.getBytes();
+  }
+  if (req_type == REQ_TYPE_SUBSCRIBE && payload_len >= 14 && (perms & PERM_ACL_ROLE_MASK) >= PERM_ACL_READ_ONLY) {
+    // req: [push_tag(4)] [channel] [lpp_type] [deadband(float)] [min_secs(2)] [max_secs(2)]   channel=0 to unsubscribe all
+    uint32_t push_tag;
+    float deadband;
+    uint16_t min_secs, max_secs;
+    memcpy(&push_tag, &payload[0], 4);
+    memcpy(&deadband, &payload[6], 4);
+    memcpy(&min_secs, &payload[10], 2);
+    memcpy(&max_secs, &payload[12], 2);
+
+    uint8_t status = SUBSCRIBE_OK;
+    if (payload[4] == 0) {
+      subscriptions.unsubscribe(sender_key);
+    } else if (!subscriptions.subscribe(sender_key, push_tag, payload[4], payload[5], deadband, min_secs, max_secs)) {
+      status = SUBSCRIBE_ERR_FULL;
+    }
+    reply_data[4] = status;
+    reply_data[5] = subscriptions.count(sender_key);
+    return 6;
+  }
+  if (req_type == REQ_TYPE_CONFIG && (perms & PERM_ACL_ROLE_MASK) == PERM_ACL_ADMIN) {
+    int len = _cli.handleConfigRequest(payload, payload_len, &reply_data[4], sizeof(reply_data) - 4);
+    if (len > 0) return 4 + len;
+  }
   return 0;  // unknown command
 }
 
@@ -372,17 +391,17 @@ bool SensorMesh::applyContactPermissions(const uint8_t* pubkey, int key_len, uin
   return true;
 }
 
-void SensorMesh::sendAlert(ContactInfo* c, Trigger* t) {
-  int text_len = strlen(t->text);
+void SensorMesh::sendAlert(ContactInfo* c, AlertDelivery* d) {
+  int text_len = strlen(d->trigger->text);
 
   uint8_t data[MAX_PACKET_PAYLOAD];
-  memcpy(data, &t->timestamp, 4);
-  data[4] = (TXT_TYPE_PLAIN << 2) | t->attempt;  // attempt and flags
-  memcpy(&data[5], t->text, text_len);
+  memcpy(data, &d->timestamp, 4);
+  data[4] = (TXT_TYPE_PLAIN << 2) | d->attempt;  // attempt and flags
+  memcpy(&data[5], d->trigger->text, text_len);
 
   // calc expected ACK reply
-  mesh::Utils::sha256((uint8_t *)&t->expected_acks[t->attempt], 4, data, 5 + text_len, self_id.pub_key, PUB_KEY_SIZE);
-  t->attempt++;
+  mesh::Utils::sha256((uint8_t *)&d->expected_acks[d->attempt], 4, data, 5 + text_len, self_id.pub_key, PUB_KEY_SIZE);
+  d->attempt++;
 
   auto pkt = createDatagram(PAYLOAD_TYPE_TXT_MSG, c->id, c->shared_secret, data, 5 + text_len);
   if (pkt) {
@@ -392,7 +411,60 @@ void SensorMesh::sendAlert(ContactInfo* c, Trigger* t) {
       sendFlood(pkt);
     }
   }
-  t->send_expiry = futureMillis(ALERT_ACK_EXPIRY_MILLIS);
+  // back-off exponentially for each retry, with some jitter so retries to many recipients don't bunch up
+  d->send_expiry = futureMillis((ALERT_ACK_EXPIRY_MILLIS << (d->attempt - 1)) + getRNG()->nextInt(0, ALERT_RETRY_JITTER_MILLIS));
+}
+
+void SensorMesh::pushTelemetry(uint32_t now) {
+  uint8_t key[TELEM_SUB_KEY_SIZE];
+  uint32_t tag;
+  int len;
+  // push: [tag(4)] [lpp records]  (as a RESPONSE, so subscriber can match it like a GET_TELEMETRY_DATA reply)
+  while ((len = subscriptions.nextPush(now, telemetry.getBuffer(), telemetry.getSize(), key, tag, &reply_data[4], sizeof(reply_data) - 4)) > 0) {
+    ContactInfo* c = getContact(key, TELEM_SUB_KEY_SIZE);
+    if (c == NULL || c->permissions == 0) {   // subscriber has since been removed
+      subscriptions.unsubscribe(key);
+      continue;
+    }
+    memcpy(reply_data, &tag, 4);
+    auto pkt = createDatagram(PAYLOAD_TYPE_RESPONSE, c->id, c->shared_secret, reply_data, 4 + len);
+    if (pkt) {
+      if (c->out_path_len >= 0) {  // we have an out_path, so send DIRECT
+        sendDirect(pkt, c->out_path, c->out_path_len, SERVER_RESPONSE_DELAY);
+      } else {
+        sendFlood(pkt, SERVER_RESPONSE_DELAY);
+      }
+    }
+  }
+}
+
+SensorMesh::AlertDelivery* SensorMesh::allocDelivery(Trigger* t, int contact_idx) {
+  AlertDelivery* slot = NULL;
+  for (int i = 0; i < MAX_ALERT_DELIVERIES; i++) {
+    auto d = &alert_deliveries[i];
+    if (d->trigger == NULL) {
+      if (slot == NULL) slot = d;
+    } else if (d->contact_idx == contact_idx && strcmp(d->trigger->text, t->text) == 0) {
+      return d;   // identical alert already in flight to this contact, don't duplicate
+    }
+  }
+  if (slot) {
+    auto c = &contacts[contact_idx];
+    memset(slot, 0, sizeof(*slot));
+    slot->trigger = t;
+    slot->contact_idx = contact_idx;
+    memcpy(slot->pub_key_prefix, c->id.pub_key, sizeof(slot->pub_key_prefix));
+    slot->max_attempts = (t->pri == LOW_PRI_ALERT) ? 1 : 4;   // Low pri alerts, only make ONE attempt
+    slot->timestamp = getRTCClock()->getCurrentTimeUnique();   // need unique timestamp per contact
+    slot->send_expiry = 0;   // send asap
+  }
+  return slot;
+}
+
+void SensorMesh::cancelDeliveries(Trigger* t) {
+  for (int i = 0; i < MAX_ALERT_DELIVERIES; i++) {
+    if (alert_deliveries[i].trigger == t) alert_deliveries[i].trigger = NULL;
+  }
 }
 
 void SensorMesh::alertIf(bool condition, Trigger& t, AlertPriority pri, const char* text) {
@@ -400,15 +472,15 @@ void SensorMesh::alertIf(bool condition, Trigger& t, AlertPriority pri, const ch
     if (!t.isTriggered() && num_alert_tasks < MAX_CONCURRENT_ALERTS) {
       StrHelper::strncpy(t.text, text, sizeof(t.text));
       t.pri = pri;
-      t.send_expiry = 0;  // signal that initial send is needed
-      t.attempt = 4;
-      t.curr_contact_idx = -1;  // start iterating thru contacts[]
+      t.next_contact_idx = 0;  // start fanning out to contacts[]
 
       alert_tasks[num_alert_tasks++] = &t;  // add to queue
     }
   } else {
     if (t.isTriggered()) {
       t.text[0] = 0;
+      cancelDeliveries(&t);
+
       // remove 't' from alert queue
       int i = 0;
       while (i < num_alert_tasks && alert_tasks[i] != &t) i++;
@@ -424,6 +496,46 @@ void SensorMesh::alertIf(bool condition, Trigger& t, AlertPriority pri, const ch
   }
 }
 
+void SensorMesh::checkAlerts() {
+  // fan-out: start a delivery for each contact that wants each queued alert, while slots are free
+  for (int i = 0; i < num_alert_tasks; i++) {
+    auto t = alert_tasks[i];
+    uint8_t pri_mask = (t->pri == HIGH_PRI_ALERT) ? PERM_RECV_ALERTS_HI : PERM_RECV_ALERTS_LO;
+    while (t->next_contact_idx < num_contacts) {
+      if ((contacts[t->next_contact_idx].permissions & pri_mask) && allocDelivery(t, t->next_contact_idx) == NULL) break;  // no free slots
+      t->next_contact_idx++;
+    }
+  }
+
+  // send/retry due deliveries. Just one send per loop(), to not flood outbound queue
+  bool sent = false;
+  for (int i = 0; i < MAX_ALERT_DELIVERIES; i++) {
+    auto d = &alert_deliveries[i];
+    if (d->trigger == NULL || !millisHasNowPassed(d->send_expiry)) continue;
+
+    auto c = &contacts[d->contact_idx];
+    if (d->attempt >= d->max_attempts || d->contact_idx >= num_contacts
+      || memcmp(c->id.pub_key, d->pub_key_prefix, sizeof(d->pub_key_prefix)) != 0) {
+      d->trigger = NULL;   // max attempts reached, OR contact list has been modified. Free the slot
+    } else if (!sent) {
+      sendAlert(c, d);  // NOTE: modifies attempt, expected_acks[] and send_expiry
+      sent = true;
+    }
+  }
+
+  // remove alerts which have been fully fanned out, and have nothing in flight
+  int j = 0;
+  for (int i = 0; i < num_alert_tasks; i++) {
+    auto t = alert_tasks[i];
+    bool busy = t->next_contact_idx < num_contacts;
+    for (int k = 0; !busy && k < MAX_ALERT_DELIVERIES; k++) {
+      busy = alert_deliveries[k].trigger == t;
+    }
+    if (busy) alert_tasks[j++] = t;
+  }
+  num_alert_tasks = j;
+}
+
 float SensorMesh::getAirtimeBudgetFactor() const {
   return _prefs.airtime_factor;
 }
@@ -572,13 +684,16 @@ void SensorMesh::onAnonDataRecv(mesh::Packet* packet, const uint8_t* secret, con
   }
 }
 
-int SensorMesh::searchPeersByHash(const uint8_t* hash) {
+int SensorMesh::searchPeersByHash(const uint8_t* hash, const mesh::Packet* packet) {
   int n = 0;
-  for (int i = 0; i < num_contacts && n < MAX_SEARCH_RESULTS; i++) {
-    if (contacts[i].id.isHashMatch(hash)) {
+  for (int i = 0; i < num_contacts; i++) {
+    auto c = &contacts[i];
+    if (c->id.isHashMatch(hash)) {
+      matching_peer_ranks[n] = calcPeerRank(isReturnPath(packet, c->out_path, c->out_path_len), c->last_activity);
       matching_peer_indexes[n++] = i;  // store the INDEXES of matching contacts (for subsequent 'peer' methods)
     }
   }
+  sortPeerCandidates(matching_peer_indexes, matching_peer_ranks, n);
   return n;
 }
 
@@ -606,7 +721,7 @@ void SensorMesh::onPeerDataRecv(mesh::Packet* packet, uint8_t type, int sender_i
     memcpy(&timestamp, data, 4);
 
     if (timestamp > from.last_timestamp) {  // prevent replay attacks
-      uint8_t reply_len = handleRequest(from.isAdmin() ? 0xFF : from.permissions, timestamp, data[4], &data[5], len - 5);
+      uint8_t reply_len = handleRequest(from.id.pub_key, from.isAdmin() ? 0xFF : from.permissions, timestamp, data[4], &data[5], len - 5);
       if (reply_len == 0) return;  // invalid command
 
       from.last_timestamp = timestamp;
@@ -700,12 +815,13 @@ bool SensorMesh::onPeerPathRecv(mesh::Packet* packet, int sender_idx, const uint
 }
 
 void SensorMesh::onAckRecv(mesh::Packet* packet, uint32_t ack_crc) {
-  if (num_alert_tasks > 0) {
-    auto t = alert_tasks[0];   // check current alert task
-    for (int i = 0; i < t->attempt; i++) {
-      if (ack_crc == t->expected_acks[i]) {   // matching ACK!
-        t->attempt = 4;  // signal to move to next contact
-        t->send_expiry = 0;
+  for (int i = 0; i < MAX_ALERT_DELIVERIES; i++) {
+    auto d = &alert_deliveries[i];
+    if (d->trigger == NULL) continue;
+
+    for (int k = 0; k < d->attempt; k++) {
+      if (ack_crc == d->expected_acks[k]) {   // matching ACK!
+        d->trigger = NULL;  // delivered, free the slot
         packet->markDoNotRetransmit();   // ACK was for this node, so don't retransmit
         return;
       }
@@ -722,6 +838,7 @@ SensorMesh::SensorMesh(mesh::MainBoard& board, mesh::Radio& radio, mesh::Millise
   dirty_contacts_expiry = 0;
   last_read_time = 0;
   num_alert_tasks = 0;
+  memset(alert_deliveries, 0, sizeof(alert_deliveries));
   set_radio_at = revert_radio_at = 0;
 
   // defaults
@@ -878,44 +995,13 @@ void SensorMesh::loop() {
     sensors.querySensors(0xFF, telemetry);  // allow all telemetry permissions
 
     onSensorDataRead();
+    pushTelemetry(curr);
 
     last_read_time = curr;
   }
 
-  // check the alert send queue
   if (num_alert_tasks > 0) {
-    auto t = alert_tasks[0];   // process head of queue
-
-    if (millisHasNowPassed(t->send_expiry)) {  // next send needed?
-      if (t->attempt >= 4) {  // max attempts reached, try next contact
-        t->curr_contact_idx++;
-        if (t->curr_contact_idx >= num_contacts) {  // no more contacts to try?
-          num_alert_tasks--;   // remove t from queue
-          for (int i = 0; i < num_alert_tasks; i++) {
-            alert_tasks[i] = alert_tasks[i + 1];
-          }
-        } else {
-          auto c = &contacts[t->curr_contact_idx];
-          uint16_t pri_mask = (t->pri == HIGH_PRI_ALERT) ? PERM_RECV_ALERTS_HI : PERM_RECV_ALERTS_LO;
-
-          if (c->permissions & pri_mask) {   // contact wants alert
-            // reset attempts
-            t->attempt = (t->pri == LOW_PRI_ALERT) ? 3 : 0;   // Low pri alerts, start at attempt #3 (ie. only make ONE attempt)
-            t->timestamp = getRTCClock()->getCurrentTimeUnique();   // need unique timestamp per contact
-
-            sendAlert(c, t);  // NOTE: modifies attempt, expected_acks[] and send_expiry
-          } else {
-            // next contact tested in next ::loop()
-          }
-        }
-      } else if (t->curr_contact_idx < num_contacts) {
-        auto c = &contacts[t->curr_contact_idx];   // send next attempt
-        sendAlert(c, t);  // NOTE: modifies attempt, expected_acks[] and send_expiry
-      } else {
-        // contact list has likely been modified while waiting for alert ACK, cancel this task
-        t->attempt = 4;   // next ::loop() will remove t from queue
-      }
-    }
+    checkAlerts();
   }
 
   // is there are pending dirty contacts write needed?
@@ -20,6 +20,7 @@
 #include <helpers/AdvertDataHelpers.h>
 #include <helpers/TxtDataHelpers.h>
 #include <helpers/CommonCLI.h>
+#include <helpers/sensors/TelemetrySubscriptions.h>
 #include <RTClib.h>
 #include <target.h>
 
@@ -60,8 +61,10 @@ struct ContactInfo {
 
 #define MAX_CONTACTS           20
 
-#define MAX_SEARCH_RESULTS      8
 #define MAX_CONCURRENT_ALERTS   4
+#ifndef MAX_ALERT_DELIVERIES
+  #define MAX_ALERT_DELIVERIES  8   // max (alert, recipient) pairs awaiting ACK at once
+#endif
 
 class SensorMesh : public mesh::Mesh, public CommonCLICallbacks {
 public:
@@ -109,12 +112,8 @@ protected:
   enum AlertPriority { LOW_PRI_ALERT, HIGH_PRI_ALERT };
 
   struct Trigger {
-    uint32_t timestamp;
     AlertPriority pri;
-    uint32_t expected_acks[4];
-    int8_t   curr_contact_idx;
-    uint8_t  attempt;
-    unsigned long send_expiry;
+    int8_t   next_contact_idx;   // fan-out cursor into contacts[]
     char text[MAX_PACKET_PAYLOAD];
 
     Trigger() { text[0] = 0; }
@@ -122,8 +121,20 @@ protected:
   };
   void alertIf(bool condition, Trigger& t, AlertPriority pri, const char* text);
 
+  // one alert to one recipient, in flight. Each has its own retry timer, so recipients don't wait on each other
+  struct AlertDelivery {
+    Trigger* trigger;    // NULL if slot is free
+    int8_t   contact_idx;
+    uint8_t  pub_key_prefix[4];   // to detect contacts[] being modified while in flight
+    uint8_t  attempt, max_attempts;
+    uint32_t timestamp;
+    uint32_t expected_acks[4];
+    unsigned long send_expiry;
+  };
+
   virtual void onSensorDataRead() = 0;   // for app to implement
   virtual int querySeriesData(uint32_t start_secs_ago, uint32_t end_secs_ago, MinMaxAvg dest[], int max_num) = 0;  // for app to implement
+  virtual int querySeriesRaw(uint8_t channel, uint8_t lpp_type, uint32_t from_time, uint32_t& first_time, uint32_t& interval_secs, float dest[], int max_num) { return 0; }  // optional, for app to implement
   virtual bool handleCustomCommand(uint32_t sender_timestamp, char* command, char* reply) { return false; }
 
   // Mesh overrides
@@ -135,7 +146,7 @@ protected:
   int getInterferenceThreshold() const override;
   int getAGCResetInterval() const override;
   void onAnonDataRecv(mesh::Packet* packet, const uint8_t* secret, const mesh::Identity& sender, uint8_t* data, size_t len) override;
-  int searchPeersByHash(const uint8_t* hash) override;
+  int searchPeersByHash(const uint8_t* hash, const mesh::Packet* packet) override;
   void getPeerSharedSecret(uint8_t* dest_secret, int peer_idx) override;
   void onPeerDataRecv(mesh::Packet* packet, uint8_t type, int sender_idx, const uint8_t* secret, uint8_t* data, size_t len) override;
   bool onPeerPathRecv(mesh::Packet* packet, int sender_idx, const uint8_t* secret, uint8_t* path, uint8_t path_len, uint8_t extra_type, uint8_t* extra, uint8_t extra_len) override;
@@ -152,9 +163,12 @@ private:
   unsigned long dirty_contacts_expiry;
   CayenneLPP telemetry;
   uint32_t last_read_time;
-  int matching_peer_indexes[MAX_SEARCH_RESULTS];
+  int matching_peer_indexes[MAX_CONTACTS];
+  uint32_t matching_peer_ranks[MAX_CONTACTS];
   int num_alert_tasks;
   Trigger* alert_tasks[MAX_CONCURRENT_ALERTS];
+  AlertDelivery alert_deliveries[MAX_ALERT_DELIVERIES];
+  TelemetrySubscriptions subscriptions;
   unsigned long set_radio_at, revert_radio_at;
   float pending_freq;
   float pending_bw;
@@ -164,12 +178,16 @@ private:
   void loadContacts();
   void saveContacts();
   uint8_t handleLoginReq(const mesh::Identity& sender, const uint8_t* secret, uint32_t sender_timestamp, const uint8_t* data);
-  uint8_t handleRequest(uint8_t perms, uint32_t sender_timestamp, uint8_t req_type, uint8_t* payload, size_t payload_len);
+  uint8_t handleRequest(const uint8_t* sender_key, uint8_t perms, uint32_t sender_timestamp, uint8_t req_type, uint8_t* payload, size_t payload_len);
   mesh::Packet* createSelfAdvert();
   ContactInfo* getContact(const uint8_t* pubkey, int key_len);
   ContactInfo* putContact(const mesh::Identity& id, uint8_t init_perms);
   bool applyContactPermissions(const uint8_t* pubkey, int key_len, uint8_t perms);
 
-  void sendAlert(ContactInfo* c, Trigger* t);
+  void sendAlert(ContactInfo* c, AlertDelivery* d);
+  AlertDelivery* allocDelivery(Trigger* t, int contact_idx);
+  void cancelDeliveries(Trigger* t);
+  void checkAlerts();
+  void pushTelemetry(uint32_t now);
 
 };
@@ -1,45 +1,240 @@
 #include "TimeSeriesData.h"
 
+#define SERIES_FILE_MAGIC   0x31445354   // 'TSD1'
+
+void TimeSeriesData::clear() {
+  for (int i = 0; i < num_slots; i++) data[i] = NAN;   // NaN = no sample
+  next = 0;
+  last_timestamp = 0;
+  for (int t = 0; t < num_tiers; t++) {
+    memset(tiers[t].buckets, 0, sizeof(SeriesBucket)*tiers[t].num);
+    tiers[t].next = 0;
+  }
+}
+
+void TimeSeriesData::addTier(uint32_t span_secs, int num_buckets) {
+  if (num_tiers >= TIME_SERIES_MAX_TIERS) return;
+
+  auto t = &tiers[num_tiers++];
+  t->span_secs = span_secs;
+  t->num = num_buckets;
+  t->next = 0;
+  t->buckets = new SeriesBucket[num_buckets];
+  memset(t->buckets, 0, sizeof(SeriesBucket)*num_buckets);
+}
+
+static File openWrite(FILESYSTEM* _fs, const char* filename) {
+#if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+  _fs->remove(filename);
+  return _fs->open(filename, FILE_O_WRITE);
+#elif defined(RP2040_PLATFORM)
+  return _fs->open(filename, "w");
+#else
+  return _fs->open(filename, "w", true);
+#endif
+}
+
+void TimeSeriesData::begin(FILESYSTEM* fs, const char* filename) {
+  _fs = fs;
+  _filename = filename;
+
+  if (!_fs->exists(_filename)) return;
+#if defined(RP2040_PLATFORM)
+  File file = _fs->open(_filename, "r");
+#else
+  File file = _fs->open(_filename);
+#endif
+  if (file) {
+    uint32_t hdr[4];
+    bool success = file.read((uint8_t *) hdr, sizeof(hdr)) == sizeof(hdr)
+        && hdr[0] == SERIES_FILE_MAGIC && hdr[1] == interval_secs && hdr[2] == num_slots && hdr[3] == num_tiers;
+    for (int t = 0; success && t < num_tiers; t++) {
+      uint32_t shape[2];
+      success = file.read((uint8_t *) shape, sizeof(shape)) == sizeof(shape) && shape[0] == tiers[t].span_secs && shape[1] == tiers[t].num;
+    }
+    // only restore if series shape is unchanged (ie. firmware config is same)
+    if (success) {
+      success = file.read((uint8_t *) &last_timestamp, 4) == 4
+             && file.read((uint8_t *) &next, sizeof(next)) == sizeof(next)
+             && file.read((uint8_t *) data, sizeof(float)*num_slots) == sizeof(float)*num_slots;
+      for (int t = 0; success && t < num_tiers; t++) {
+        success = file.read((uint8_t *) &tiers[t].next, sizeof(int)) == sizeof(int)
+               && file.read((uint8_t *) tiers[t].buckets, sizeof(SeriesBucket)*tiers[t].num) == sizeof(SeriesBucket)*tiers[t].num;
+      }
+      if (!success || next < 0 || next >= num_slots) {
+        MESH_DEBUG_PRINTLN("TimeSeriesData: corrupt file %s", _filename);
+        clear();
+      }
+    }
+    file.close();
+  }
+}
+
+bool TimeSeriesData::save() {
+  if (_fs == NULL) return false;
+
+  File file = openWrite(_fs, _filename);
+  if (!file) return false;
+
+  uint32_t hdr[4] = { SERIES_FILE_MAGIC, interval_secs, (uint32_t) num_slots, (uint32_t) num_tiers };
+  file.write((uint8_t *) hdr, sizeof(hdr));
+  for (int t = 0; t < num_tiers; t++) {
+    uint32_t shape[2] = { tiers[t].span_secs, (uint32_t) tiers[t].num };
+    file.write((uint8_t *) shape, sizeof(shape));
+  }
+  file.write((uint8_t *) &last_timestamp, 4);
+  file.write((uint8_t *) &next, sizeof(next));
+  file.write((uint8_t *) data, sizeof(float)*num_slots);
+  for (int t = 0; t < num_tiers; t++) {
+    file.write((uint8_t *) &tiers[t].next, sizeof(int));
+    file.write((uint8_t *) tiers[t].buckets, sizeof(SeriesBucket)*tiers[t].num);
+  }
+  file.close();
+  return true;
+}
+
+bool TimeSeriesData::addToTiers(uint32_t now, float value) {
+  bool rolled_over = false;
+  for (int i = 0; i < num_tiers; i++) {
+    auto t = &tiers[i];
+    uint32_t start = now - (now % t->span_secs);
+    auto b = &t->buckets[(t->next + t->num - 1) % t->num];   // current (most recent) bucket
+    if (b->start != start) {
+      if (b->start != 0 && i == 0) rolled_over = true;
+
+      b = &t->buckets[t->next];   // start a new bucket (overwriting oldest)
+      t->next = (t->next + 1) % t->num;
+      b->start = start;
+      b->count = 0;
+    }
+    if (b->count == 0) {
+      b->_min = b->_max = b->_sum = value;
+    } else {
+      if (value < b->_min) b->_min = value;
+      if (value > b->_max) b->_max = value;
+      b->_sum += value;
+    }
+    b->count++;
+  }
+  return rolled_over;
+}
+
 void TimeSeriesData::recordData(mesh::RTCClock* clock, float value) {
   uint32_t now = clock->getCurrentTime();
+  if (now < last_timestamp) {
+    if (!clock_synced || last_timestamp - now <= interval_secs) {
+      return;   // RTC not set yet since boot (history was loaded from file), or a small adjustment. Drop sample
+    }
+    MESH_DEBUG_PRINTLN("TimeSeriesData: clock went backwards, history cleared");   // clock was set back, history is now meaningless
+    clear();
+  }
+  clock_synced = true;
   if (now >= last_timestamp + interval_secs) {
+    if (last_timestamp > 0) {   // mark any missed slots as empty, so slot times stay implicit
+      uint32_t missed = (now - last_timestamp) / interval_secs - 1;
+      if (missed > num_slots) missed = num_slots;
+      while (missed-- > 0) {
+        data[next] = NAN;
+        next = (next + 1) % num_slots;
+      }
+    }
     last_timestamp = now;
 
     data[next] = value;   // append to cycle table
     next = (next + 1) % num_slots;
+
+    if (addToTiers(now, value)) save();   // persist about once per first-tier span (ie. not too often)
   }
 }
 
-void TimeSeriesData::calcMinMaxAvg(mesh::RTCClock* clock, uint32_t start_secs_ago, uint32_t end_secs_ago, MinMaxAvg* dest, uint8_t channel, uint8_t lpp_type) const {
+// returns -1 for raw ring, else tier index
+int TimeSeriesData::findSource(uint32_t start_secs_ago, uint32_t end_secs_ago) const {
+  uint32_t range = start_secs_ago - end_secs_ago;
+
+  if (start_secs_ago <= num_slots * interval_secs && range <= TIME_SERIES_MAX_SCAN * interval_secs) return -1;
+  for (int i = 0; i < num_tiers; i++) {
+    auto t = &tiers[i];
+    if (start_secs_ago <= t->num * t->span_secs && range <= TIME_SERIES_MAX_SCAN * t->span_secs) return i;
+  }
+  return num_tiers - 1;   // coarsest tier, or raw if none
+}
+
+void TimeSeriesData::mergeRaw(uint32_t now, uint32_t start_secs_ago, uint32_t end_secs_ago, float& mn, float& mx, float& sum, int& count) const {
   int i = next, n = num_slots;
-  uint32_t ago = clock->getCurrentTime() - last_timestamp;
+  uint32_t ago = now - last_timestamp;
+
+  // start at most recent recording, back-track through to oldest
+  while (n > 0 && ago < start_secs_ago) {
+    n--;
+    i = (i + num_slots - 1) % num_slots;  // go back by one
+    float v = data[i];
+    if (ago >= end_secs_ago && !isnan(v)) {   // filter by the desired time range
+      if (count == 0 || v < mn) mn = v;
+      if (count == 0 || v > mx) mx = v;
+      sum += v;
+      count++;
+    }
+    ago += interval_secs;
+  }
+}
+
+void TimeSeriesData::mergeTier(const Tier& t, uint32_t now, uint32_t start_secs_ago, uint32_t end_secs_ago, float& mn, float& mx, float& sum, int& count) const {
+  uint32_t from = now - start_secs_ago, to = now - end_secs_ago;
+  int i = t.next;
+  for (int n = 0; n < t.num; n++) {
+    i = (i + t.num - 1) % t.num;  // go back by one
+    auto b = &t.buckets[i];
+    if (b->start == 0 || b->start + t.span_secs <= from) break;  // this, and older buckets, are outside range
+
+    if (b->start < to && b->count > 0) {   // NOTE: buckets partly overlapping range are included whole
+      if (count == 0 || b->_min < mn) mn = b->_min;
+      if (count == 0 || b->_max > mx) mx = b->_max;
+      sum += b->_sum;
+      count += b->count;
+    }
+  }
+}
+
+void TimeSeriesData::calcMinMaxAvg(mesh::RTCClock* clock, uint32_t start_secs_ago, uint32_t end_secs_ago, MinMaxAvg* dest, uint8_t channel, uint8_t lpp_type) const {
+  uint32_t now = clock->getCurrentTime();
+  float mn = 0, mx = 0, total = 0.0f;
   int num_values = 0;
-  float total = 0.0f;
 
   dest->_channel = channel;
   dest->_lpp_type = lpp_type;
 
-  // start at most recet recording, back-track through to oldest
-  while (n > 0) {
-    n--;
-    i = (i + num_slots - 1) % num_slots;  // go back by one
-    if (ago >= end_secs_ago && ago < start_secs_ago) {   // filter by the desired time range
-      float v = data[i];
-      num_values++;
-      total += v;
-      if (num_values == 1) {
-        dest->_max = dest->_min = v;
-      } else {
-        if (v < dest->_min) dest->_min = v;
-        if (v > dest->_max) dest->_max = v;
-      }
+  if (start_secs_ago > now) start_secs_ago = now;
+  if (last_timestamp > 0 && end_secs_ago < start_secs_ago) {
+    int src = findSource(start_secs_ago, end_secs_ago);
+    if (src < 0) {
+      mergeRaw(now, start_secs_ago, end_secs_ago, mn, mx, total, num_values);
+    } else {
+      mergeTier(tiers[src], now, start_secs_ago, end_secs_ago, mn, mx, total, num_values);
     }
-    ago += interval_secs;
   }
   // calc average
   if (num_values > 0) {
+    dest->_min = mn;
+    dest->_max = mx;
     dest->_avg = total / num_values;
   } else {
     dest->_max = dest->_min = dest->_avg = NAN;
   }
 }
+
+int TimeSeriesData::getRawSamples(uint32_t from_time, uint32_t& first_time, float dest[], int max_num) const {
+  if (last_timestamp == 0 || from_time > last_timestamp) return 0;
+
+  // number of slots from oldest wanted, up to and including most recent
+  uint32_t n = (last_timestamp - from_time) / interval_secs + 1;
+  if (n > num_slots) n = num_slots;
+
+  first_time = last_timestamp - (n - 1) * interval_secs;
+  int i = (next + num_slots - n) % num_slots;
+  int count = 0;
+  while (count < n && count < max_num) {
+    dest[count++] = data[i];
+    i = (i + 1) % num_slots;
+  }
+  return count;
+}
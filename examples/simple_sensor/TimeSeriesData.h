@@ -2,28 +2,96 @@
 
 #include <Arduino.h>
 #include <Mesh.h>
+#include <helpers/IdentityStore.h>
+
+#ifndef TIME_SERIES_MAX_TIERS
+  #define TIME_SERIES_MAX_TIERS   3
+#endif
+
+#ifndef TIME_SERIES_MAX_SCAN
+  #define TIME_SERIES_MAX_SCAN    48   // max raw slots/buckets a query should walk, before using a coarser tier
+#endif
 
 struct MinMaxAvg {
   float _min, _max, _avg;
   uint8_t _lpp_type, _channel;
 };
 
+/**
+ * \brief  a pre-aggregated summary of all samples in [start, start + tier span)
+*/
+struct SeriesBucket {
+  uint32_t start;   // by our RTC clock, aligned to tier span. Zero means empty
+  float _min, _max, _sum;
+  uint16_t count;
+};
+
+/**
+ * \brief  Fixed interval ring of raw samples, plus optional coarser tiers (eg. hourly, daily) of min/max/avg
+ *         buckets which keep a much longer history in the same RAM. Queries use the finest data source that
+ *         covers the requested range in at most TIME_SERIES_MAX_SCAN steps.
+ *         If begin() is given a file, the whole series is re-loaded at boot, and saved each time the first tier
+ *         rolls over to a new bucket.
+*/
 class TimeSeriesData {
   float* data;
   int num_slots, next;
   uint32_t last_timestamp;
   uint32_t interval_secs;
+  bool clock_synced;   // RTC has caught up with last_timestamp since boot
+
+  struct Tier {
+    uint32_t span_secs;
+    SeriesBucket* buckets;
+    int num, next;
+  };
+  Tier tiers[TIME_SERIES_MAX_TIERS];
+  int num_tiers;
+
+  FILESYSTEM* _fs;
+  const char* _filename;
+
+  void clear();
+  bool addToTiers(uint32_t now, float value);
+  int findSource(uint32_t start_secs_ago, uint32_t end_secs_ago) const;
+  void mergeRaw(uint32_t now, uint32_t start_secs_ago, uint32_t end_secs_ago, float& mn, float& mx, float& sum, int& count) const;
+  void mergeTier(const Tier& t, uint32_t now, uint32_t start_secs_ago, uint32_t end_secs_ago, float& mn, float& mx, float& sum, int& count) const;
 
 public:
-  TimeSeriesData(float* array, int num, uint32_t secs) : num_slots(num), data(array), last_timestamp(0), next(0), interval_secs(secs) { 
-    memset(data, 0, sizeof(float)*num);
+  TimeSeriesData(float* array, int num, uint32_t secs) : num_slots(num), data(array), last_timestamp(0), next(0), interval_secs(secs) {
+    num_tiers = 0;
+    _fs = NULL;
+    clock_synced = false;
+    clear();
   }
   TimeSeriesData(int num, uint32_t secs) : num_slots(num), last_timestamp(0), next(0), interval_secs(secs) {
     data = new float[num];
-    memset(data, 0, sizeof(float)*num);
+    num_tiers = 0;
+    _fs = NULL;
+    clock_synced = false;
+    clear();
   }
 
+  /**
+   * \brief  adds a coarser tier. Must be called in order of increasing span, and before begin()
+  */
+  void addTier(uint32_t span_secs, int num_buckets);
+
+  /**
+   * \brief  loads persisted series (if any), and enables saving to given file.
+  */
+  void begin(FILESYSTEM* fs, const char* filename);
+  bool save();
+
   void recordData(mesh::RTCClock* clock, float value);
   void calcMinMaxAvg(mesh::RTCClock* clock, uint32_t start_secs_ago, uint32_t end_secs_ago, MinMaxAvg* dest, uint8_t channel, uint8_t lpp_type) const;
-};
 
+  uint32_t getInterval() const { return interval_secs; }
+
+  /**
+   * \brief  copies raw samples (oldest first) recorded at or after from_time. Sample 'i' was recorded at
+   *         first_time + i * getInterval(). Missed samples are NaN.
+   * \returns  number of samples copied
+  */
+  int getRawSamples(uint32_t from_time, uint32_t& first_time, float dest[], int max_num) const;
+};
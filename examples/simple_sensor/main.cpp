@@ -11,6 +11,13 @@ public:
      : SensorMesh(board, radio, ms, rng, rtc, tables), 
        battery_data(12*24, 5*60)    // 24 hours worth of battery data, every 5 minutes
   {
+    battery_data.addTier(60*60, 48);      // plus hourly summary for 2 days
+    battery_data.addTier(24*60*60, 35);   // and daily summary for 5 weeks
+  }
+
+  void begin(FILESYSTEM* fs) {
+    SensorMesh::begin(fs);
+    battery_data.begin(fs, "/ts_batt");   // restore history from before reboot
   }
 
 protected:
@@ -31,6 +38,13 @@ protected:
     return 1;
   }
 
+  int querySeriesRaw(uint8_t channel, uint8_t lpp_type, uint32_t from_time, uint32_t& first_time, uint32_t& interval_secs, float dest[], int max_num) override {
+    if (channel != TELEM_CHANNEL_SELF || lpp_type != LPP_VOLTAGE) return 0;
+
+    interval_secs = battery_data.getInterval();
+    return battery_data.getRawSamples(from_time, first_time, dest, max_num);
+  }
+
   bool handleCustomCommand(uint32_t sender_timestamp, char* command, char* reply) override {
     if (strcmp(command, "magic") == 0) {    // example 'custom' command handling
       strcpy(reply, "**Magic now done**");
@@ -32,7 +32,7 @@ int Dispatcher::calcRxDelay(float score, uint32_t air_time) const {
   return (int) ((pow(10, 0.85f - score) - 1.0) * air_time);
 }
 
-uint32_t Dispatcher::getCADFailRetryDelay() const {
+uint32_t Dispatcher::getCADFailRetryDelay(uint8_t priority, int num_fails) const {
   return 200;
 }
 uint32_t Dispatcher::getCADFailMaxDuration() const {
@@ -60,10 +60,16 @@ void Dispatcher::loop() {
 
   if (outbound) {  // waiting for outbound send to be completed
     if (_radio->isSendComplete()) {
-      long t = _ms->getMillis() - outbound_start;
+      uint32_t air_micros = _radio->getLastSendAirtimeMicros();
+      long t = air_micros > 0 ? (air_micros + 500) / 1000 : _ms->getMillis() - outbound_start;  // prefer exact, from radio interrupts
       total_air_time += t;  // keep track of how much air time we are using
       //Serial.print("  airtime="); Serial.println(t);
 
+      if (outbound->_rx_micros != 0 && _radio->getLastSendMicros() != 0) {   // was a re-transmit
+        MESH_DEBUG_PRINTLN("%s Dispatcher::loop(): retransmit turnaround=%d ms, airtime=%d ms", getLogDateTime(),
+            (int)((_radio->getLastSendMicros() - outbound->_rx_micros) / 1000), (int)t);
+      }
+
       // will need radio silence up to next_tx_time
       next_tx_time = futureMillis(t * getAirtimeBudgetFactor());
 
@@ -157,6 +163,7 @@ void Dispatcher::checkRecv() {
             memcpy(pkt->payload, &raw[i], pkt->payload_len);
 
             pkt->_snr = _radio->getLastSNR() * 4.0f;
+            pkt->_rx_micros = _radio->getLastRecvMicros();
             score = _radio->packetScore(_radio->getLastSNR(), len);
             air_time = _radio->getEstAirtimeFor(len);
           }
@@ -209,7 +216,10 @@ void Dispatcher::checkRecv() {
 }
 
 void Dispatcher::processRecvPacket(Packet* pkt) {
-  DispatcherAction action = onRecvPacket(pkt);
+  applyRecvAction(pkt, onRecvPacket(pkt));
+}
+
+void Dispatcher::applyRecvAction(Packet* pkt, DispatcherAction action) {
   if (action == ACTION_RELEASE) {
     _mgr->free(pkt);
   } else if (action == ACTION_MANUAL_HOLD) {
@@ -237,11 +247,13 @@ void Dispatcher::checkSend() {
       // channel activity has gone on too long... (Radio might be in a bad state)
       // force the pending transmit below...
     } else {
-      next_tx_time = futureMillis(getCADFailRetryDelay());
+      int pri = _mgr->getNextOutboundPriority(_ms->getMillis());
+      next_tx_time = futureMillis(getCADFailRetryDelay(pri < 0 ? 0 : pri, ++cad_fail_count));
       return;
     }
   }
   cad_busy_start = 0;  // reset busy state
+  cad_fail_count = 0;
 
   outbound = _mgr->getNextOutbound(_ms->getMillis());
   if (outbound) {
@@ -266,6 +278,11 @@ void Dispatcher::checkSend() {
     } else {
       memcpy(&raw[len], outbound->payload, outbound->payload_len); len += outbound->payload_len;
 
+      uint8_t tx_power = getTxPowerFor(outbound);
+      if (tx_power > 0) {
+        _radio->setTxPower(tx_power);
+      }
+
       uint32_t max_airtime = _radio->getEstAirtimeFor(len)*3/2;
       outbound_start = _ms->getMillis();
       bool success = _radio->startSendRaw(raw, len);
@@ -302,6 +319,7 @@ Packet* Dispatcher::obtainNewPacket() {
   } else {
     pkt->payload_len = pkt->path_len = 0;
     pkt->_snr = 0;
+    pkt->_rx_micros = 0;
   }
   return pkt;
 }
@@ -329,4 +347,21 @@ unsigned long Dispatcher::futureMillis(int millis_from_now) const {
   return _ms->getMillis() + millis_from_now;
 }
 
+uint32_t Dispatcher::millisUntil(unsigned long timestamp, uint32_t max_millis) const {
+  long left = (long)(timestamp - _ms->getMillis());
+  if (left <= 0) return 0;
+  return (uint32_t)left < max_millis ? left : max_millis;
+}
+
+uint32_t Dispatcher::getIdleMillis(uint32_t max_millis) const {
+  if (outbound || _mgr->getOutboundCount(0xFFFFFFFF) > 0) return 0;   // sending, or waiting to send
+
+  uint32_t ms = millisUntil(next_floor_calib_time, max_millis);
+  if (getAGCResetInterval() > 0) ms = millisUntil(next_agc_reset_time, ms);
+
+  uint32_t inbound_at;
+  if (_mgr->getNextInboundTime(inbound_at)) ms = millisUntil(inbound_at, ms);   // delayed (rx_delay) packet
+  return ms;
+}
+
 }
\ No newline at end of file
@@ -67,6 +67,19 @@ public:
 
   virtual void resetAGC() { }
 
+  virtual void setTxPower(uint8_t dbm) { }
+
+  /**
+   * \brief  enables low power (duty-cycled) receive, if radio supports it. Packets with a full length preamble
+   *       are still received, but RSSI based stats (noise floor, etc) are not available.
+  */
+  virtual void setRxDutyCycle(bool enable) { }
+
+  /**
+   * \returns  true if radio is just listening, and will raise its interrupt when anything happens. ie. MCU can sleep
+  */
+  virtual bool isSleepAllowed() const { return false; }
+
   virtual bool isInRecvMode() const = 0;
 
   /**
@@ -75,6 +88,22 @@ public:
   virtual bool isReceiving() { return false; }
 
   virtual float getLastRSSI() const { return 0; }
+
+  /**
+   * \returns  micros() timestamp of when the packet last returned by recvRaw() finished arriving (taken in the
+   *      radio interrupt, so free of polling latency), or zero if not supported.
+  */
+  virtual uint32_t getLastRecvMicros() const { return 0; }
+
+  /**
+   * \returns  micros() timestamp of when the last send actually started, or zero if not supported.
+  */
+  virtual uint32_t getLastSendMicros() const { return 0; }
+
+  /**
+   * \returns  measured on-air time of last completed send, in microseconds, or zero if not supported.
+  */
+  virtual uint32_t getLastSendAirtimeMicros() const { return 0; }
   virtual float getLastSNR() const { return 0; }
 };
 
@@ -90,11 +119,13 @@ public:
   virtual void queueOutbound(Packet* packet, uint8_t priority, uint32_t scheduled_for) = 0;
   virtual Packet* getNextOutbound(uint32_t now) = 0;    // by priority
   virtual int getOutboundCount(uint32_t now) const = 0;
+  virtual int getNextOutboundPriority(uint32_t now) const = 0;   // -1 if none due
   virtual int getFreeCount() const = 0;
   virtual Packet* getOutboundByIdx(int i) = 0;
   virtual Packet* removeOutboundByIdx(int i) = 0;
   virtual void queueInbound(Packet* packet, uint32_t scheduled_for) = 0;
   virtual Packet* getNextInbound(uint32_t now) = 0;
+  virtual bool getNextInboundTime(uint32_t& scheduled_for) const = 0;   // false if inbound queue is empty
 };
 
 typedef uint32_t  DispatcherAction;
@@ -117,6 +148,7 @@ class Dispatcher {
   unsigned long outbound_expiry, outbound_start, total_air_time;
   unsigned long next_tx_time;
   unsigned long cad_busy_start;
+  int cad_fail_count;    // consecutive LBT fails, for backoff
   unsigned long radio_nonrx_start;
   unsigned long next_floor_calib_time, next_agc_reset_time;
   bool  prev_isrecv_mode;
@@ -136,6 +168,7 @@ protected:
   {
     outbound = NULL; total_air_time = 0; next_tx_time = 0;
     cad_busy_start = 0;
+    cad_fail_count = 0;
     next_floor_calib_time = next_agc_reset_time = 0;
     _err_flags = 0;
     radio_nonrx_start = 0;
@@ -153,11 +186,24 @@ protected:
 
   virtual float getAirtimeBudgetFactor() const;
   virtual int calcRxDelay(float score, uint32_t air_time) const;
-  virtual uint32_t getCADFailRetryDelay() const;
+  /**
+   * \brief  how long to back off after channel was found busy (LBT)
+   * \param  priority  of the packet waiting to be sent (0 = most important)
+   * \param  num_fails  number of consecutive busy results (1 on first)
+  */
+  virtual uint32_t getCADFailRetryDelay(uint8_t priority, int num_fails) const;
   virtual uint32_t getCADFailMaxDuration() const;
   virtual int getInterferenceThreshold() const { return 0; }    // disabled by default
   virtual int getAGCResetInterval() const { return 0; }    // disabled by default
 
+  /**
+   * \returns  TX power (dBm) to set radio to before sending this packet, or zero to leave as is.
+  */
+  virtual uint8_t getTxPowerFor(const Packet* packet) { return 0; }
+
+  /** \brief  carries out the action onRecvPacket() returned for given packet (free, hold, or queue for retransmit) */
+  void applyRecvAction(Packet* pkt, DispatcherAction action);
+
 public:
   void begin();
   void loop();
@@ -176,9 +222,16 @@ public:
     _err_flags = 0;
   }
 
+  /**
+   * \brief  for power saving, how long until there is more work for loop() to do (other than via a radio interrupt)
+   * \returns  milliseconds, capped at max_millis. Zero if something is due now, or waiting to be sent
+  */
+  virtual uint32_t getIdleMillis(uint32_t max_millis) const;
+
   // helper methods
   bool millisHasNowPassed(unsigned long timestamp) const;
   unsigned long futureMillis(int millis_from_now) const;
+  uint32_t millisUntil(unsigned long timestamp, uint32_t max_millis) const;   // capped at max_millis, zero if passed
 
 private:
   void checkRecv();
@@ -9,6 +9,99 @@ void Mesh::begin() {
 
 void Mesh::loop() {
   Dispatcher::loop();
+  releaseHeldPackets();
+}
+
+uint32_t Mesh::getIdleMillis(uint32_t max_millis) const {
+  uint32_t ms = Dispatcher::getIdleMillis(max_millis);
+  for (int k = 0; k < FLOOD_PATH_MAX_HELD; k++) {
+    if (_held[k].packet) ms = millisUntil(_held[k].release_at, ms);
+  }
+  return ms;
+}
+
+static int16_t scoreFloodPath(const Packet* packet) {
+  return packet->_snr - packet->path_len * FLOOD_PATH_HOP_COST;
+}
+
+bool Mesh::holdForBestPath(Packet* packet) {
+  if (packet == _replay_pkt || !packet->isRouteFlood()) return false;
+  uint32_t window = getFloodPathWindow(packet);
+  if (window == 0) return false;
+
+  for (int k = 0; k < FLOOD_PATH_MAX_HELD; k++) {
+    auto h = &_held[k];
+    if (h->packet == NULL) {
+      h->packet = packet;
+      h->release_at = futureMillis(window);
+      h->score = scoreFloodPath(packet);
+      packet->calculatePacketHash(h->hash);
+      return true;
+    }
+  }
+  return false;   // all slots in use, so just handle it now
+}
+
+bool Mesh::updateHeldPath(const Packet* packet) {
+  uint8_t hash[MAX_HASH_SIZE];
+  bool calc = false;
+  for (int k = 0; k < FLOOD_PATH_MAX_HELD; k++) {
+    auto h = &_held[k];
+    if (h->packet == NULL) continue;
+
+    if (!calc) { packet->calculatePacketHash(hash); calc = true; }
+    if (memcmp(hash, h->hash, MAX_HASH_SIZE) == 0) {
+      int16_t score = scoreFloodPath(packet);
+      if (score > h->score) {
+        MESH_DEBUG_PRINTLN("%s better flood path: %d hops, score=%d (was %d)", getLogDateTime(), (uint32_t)packet->path_len, (int)score, (int)h->score);
+        h->score = score;
+        memcpy(h->packet->path, packet->path, h->packet->path_len = packet->path_len);
+        h->packet->_snr = packet->_snr;
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+void Mesh::releaseHeldPackets() {
+  for (int k = 0; k < FLOOD_PATH_MAX_HELD; k++) {
+    auto h = &_held[k];
+    if (h->packet && millisHasNowPassed(h->release_at)) {
+      uint32_t n_decrypts = _n_peer_decrypts, n_attempts = _n_mac_attempts;   // were counted on first receive, don't count again
+
+      _replay_pkt = h->packet;
+      h->packet = NULL;
+      // NOTE: bypass any sub-class onRecvPacket() hooks, as they have already seen this packet
+      applyRecvAction(_replay_pkt, Mesh::onRecvPacket(_replay_pkt));
+      _replay_pkt = NULL;
+
+      _n_peer_decrypts = n_decrypts; _n_mac_attempts = n_attempts;
+    }
+  }
+}
+
+void Mesh::calcAnonSecret(uint8_t* secret, const Identity& sender) {
+  // key exchange is by far the most expensive step of handling an ANON_REQ, and clients tend to send several
+  // in a row (login retries, then requests), so keep the last few results
+  if (_num_anon_secrets > 0 && memcmp(_anon_self_key, self_id.pub_key, PUB_KEY_SIZE) != 0) {
+    _num_anon_secrets = _next_anon_secret = 0;   // our identity has changed, flush
+  }
+  for (int i = 0; i < _num_anon_secrets; i++) {
+    if (sender.matches(_anon_secrets[i].sender_key)) {
+      memcpy(secret, _anon_secrets[i].secret, PUB_KEY_SIZE);
+      return;
+    }
+  }
+
+  self_id.calcSharedSecret(secret, sender);
+
+  auto entry = &_anon_secrets[_next_anon_secret];
+  memcpy(entry->sender_key, sender.pub_key, PUB_KEY_SIZE);
+  memcpy(entry->secret, secret, PUB_KEY_SIZE);
+  memcpy(_anon_self_key, self_id.pub_key, PUB_KEY_SIZE);
+  _next_anon_secret = (_next_anon_secret + 1) % ANON_SECRET_CACHE_SIZE;
+  if (_num_anon_secrets < ANON_SECRET_CACHE_SIZE) _num_anon_secrets++;
 }
 
 bool Mesh::allowPacketForward(const mesh::Packet* packet) { 
@@ -26,18 +119,71 @@ uint8_t Mesh::getExtraAckTransmitCount() const {
   return 0;
 }
 
-uint32_t Mesh::getCADFailRetryDelay() const {
-  return _rng->nextInt(1, 4)*120;
+uint32_t Mesh::getFloodPathWindow(const Packet* packet) const {
+  return 0;  // by default, first copy is handled immediately
+}
+
+uint32_t Mesh::getCADFailRetryDelay(uint8_t priority, int num_fails) const {
+  uint32_t cw = CAD_BACKOFF_CW_MIN * (1 + (priority < 3 ? priority : 3));
+  for (int i = 1; i < num_fails && cw < CAD_BACKOFF_CW_MAX; i++) cw <<= 1;
+  if (cw > CAD_BACKOFF_CW_MAX) cw = CAD_BACKOFF_CW_MAX;
+
+  return _rng->nextInt(1, cw + 1) * CAD_BACKOFF_SLOT_MILLIS;
 }
 
-int Mesh::searchPeersByHash(const uint8_t* hash) {
+int Mesh::searchPeersByHash(const uint8_t* hash, const Packet* packet) {
   return 0;  // not found
 }
 
-int Mesh::searchChannelsByHash(const uint8_t* hash, GroupChannel channels[], int max_matches) {
+bool Mesh::isReturnPath(const Packet* packet, const uint8_t* out_path, int8_t out_path_len) {
+  if (!packet->isRouteFlood() || out_path_len < 0 || out_path_len != packet->path_len) return false;
+
+  for (int k = 0; k < out_path_len; k++) {
+    if (out_path[k] != packet->path[packet->path_len - 1 - k]) return false;
+  }
+  return true;
+}
+
+void Mesh::sortPeerCandidates(int* indexes, uint32_t* ranks, int n) {
+  for (int i = 1; i < n; i++) {   // insertion sort, n is nearly always tiny
+    int idx = indexes[i];
+    uint32_t rank = ranks[i];
+    int j = i - 1;
+    while (j >= 0 && ranks[j] < rank) {
+      indexes[j + 1] = indexes[j];
+      ranks[j + 1] = ranks[j];
+      j--;
+    }
+    indexes[j + 1] = idx;
+    ranks[j + 1] = rank;
+  }
+}
+
+int Mesh::searchChannelsByHash(const uint8_t* hash) {
   return 0;  // not found
 }
 
+// GRP_TXT plaintext is: timestamp(4), txt_type(1), then "name: text" zero padded. With the wrong key, the first
+// block is very unlikely to have a small txt_type AND no control chars in the rest.
+static bool isPlausibleGroupText(const uint8_t* secret, const uint8_t* ciphertext) {
+  uint8_t block[CIPHER_BLOCK_SIZE];
+  Utils::decrypt(secret, block, ciphertext, CIPHER_BLOCK_SIZE);
+
+  if (block[4] >= 0x40) return false;
+  bool padding = false;
+  for (int k = 5; k < CIPHER_BLOCK_SIZE; k++) {
+    uint8_t c = block[k];
+    if (padding) {
+      if (c != 0) return false;
+    } else if (c == 0) {
+      padding = true;
+    } else if (c < 0x20 || c == 0x7F) {
+      return false;
+    }
+  }
+  return true;
+}
+
 DispatcherAction Mesh::onRecvPacket(Packet* pkt) {
   if (pkt->getPayloadVer() > PAYLOAD_VER_1) {  // not supported in this firmware version
     MESH_DEBUG_PRINTLN("%s Mesh::onRecvPacket(): unsupported packet version", getLogDateTime());
@@ -68,6 +214,10 @@ DispatcherAction Mesh::onRecvPacket(Packet* pkt) {
     return ACTION_RELEASE;
   }
 
+  if (pkt->isRouteFlood() && updateHeldPath(pkt)) {
+    return ACTION_RELEASE;   // another copy of a packet being held
+  }
+
   if (pkt->isRouteDirect() && pkt->path_len >= PATH_HASH_SIZE) {
     if (self_id.isHashMatch(pkt->path) && allowPacketForward(pkt)) {
       if (pkt->getPayloadType() == PAYLOAD_TYPE_MULTIPART) {
@@ -116,14 +266,13 @@ DispatcherAction Mesh::onRecvPacket(Packet* pkt) {
       uint8_t* macAndData = &pkt->payload[i];   // MAC + encrypted data 
       if (i + CIPHER_MAC_SIZE >= pkt->payload_len) {
         MESH_DEBUG_PRINTLN("%s Mesh::onRecvPacket(): incomplete data packet", getLogDateTime());
-      } else if (!_tables->hasSeen(pkt)) {
-        // NOTE: this is a 'first packet wins' impl. When receiving from multiple paths, the first to arrive wins.
-        //       For flood mode, the path may not be the 'best' in terms of hops.
-        // FUTURE: could send back multiple paths, using createPathReturn(), and let sender choose which to use(?)
+      } else if (isNewPacket(pkt)) {
+        // NOTE: flood packets for us are held for getFloodPathWindow(), then handled with the best path of the
+        //       copies received in that time (see updateHeldPath()), so that is the path which gets returned.
 
         if (self_id.isHashMatch(&dest_hash)) {
-          // scan contacts DB, for all matching hashes of 'src_hash' (max 4 matches supported ATM)
-          int num = searchPeersByHash(&src_hash);
+          // scan contacts DB, for all matching hashes of 'src_hash' (most likely sender first)
+          int num = searchPeersByHash(&src_hash, pkt);
           // for each matching contact, try to decrypt data
           bool found = false;
           for (int j = 0; j < num; j++) {
@@ -132,8 +281,16 @@ DispatcherAction Mesh::onRecvPacket(Packet* pkt) {
 
             // decrypt, checking MAC is valid
             uint8_t data[MAX_PACKET_PAYLOAD];
+            _n_mac_attempts++;
             int len = Utils::MACThenDecrypt(secret, data, macAndData, pkt->payload_len - i);
             if (len > 0) {  // success!
+              _n_peer_decrypts++;
+              if (holdForBestPath(pkt)) {
+                return ACTION_MANUAL_HOLD;   // handle after more copies have had a chance to arrive
+              }
+              if (j > 0) {
+                MESH_DEBUG_PRINTLN("%s recv src_hash=%02X decrypted on candidate %d of %d", getLogDateTime(), (uint32_t)src_hash, j + 1, num);
+              }
               if (pkt->getPayloadType() == PAYLOAD_TYPE_PATH) {
                 int k = 0;
                 uint8_t path_len = data[k++];
@@ -173,17 +330,20 @@ DispatcherAction Mesh::onRecvPacket(Packet* pkt) {
       uint8_t* macAndData = &pkt->payload[i];   // MAC + encrypted data 
       if (i + 2 >= pkt->payload_len) {
         MESH_DEBUG_PRINTLN("%s Mesh::onRecvPacket(): incomplete data packet", getLogDateTime());
-      } else if (!_tables->hasSeen(pkt)) {
+      } else if (isNewPacket(pkt)) {
         if (self_id.isHashMatch(&dest_hash)) {
           Identity sender(sender_pub_key);
 
           uint8_t secret[PUB_KEY_SIZE];
-          self_id.calcSharedSecret(secret, sender);
+          calcAnonSecret(secret, sender);
 
           // decrypt, checking MAC is valid
           uint8_t data[MAX_PACKET_PAYLOAD];
           int len = Utils::MACThenDecrypt(secret, data, macAndData, pkt->payload_len - i);
           if (len > 0) {  // success!
+            if (holdForBestPath(pkt)) {
+              return ACTION_MANUAL_HOLD;   // handle after more copies have had a chance to arrive
+            }
             onAnonDataRecv(pkt, secret, sender, data, len);
             pkt->markDoNotRetransmit();
           }
@@ -201,17 +361,29 @@ DispatcherAction Mesh::onRecvPacket(Packet* pkt) {
       if (i + 2 >= pkt->payload_len) {
         MESH_DEBUG_PRINTLN("%s Mesh::onRecvPacket(): incomplete data packet", getLogDateTime());
       } else if (!_tables->hasSeen(pkt)) {
-        // scan channels DB, for all matching hashes of 'channel_hash' (max 2 matches supported ATM)
-        GroupChannel channels[2];
-        int num = searchChannelsByHash(&channel_hash, channels, 2);
-        // for each matching channel, try to decrypt data
-        for (int j = 0; j < num; j++) {
-          // decrypt, checking MAC is valid
-          uint8_t data[MAX_PACKET_PAYLOAD];
-          int len = Utils::MACThenDecrypt(channels[j].secret, data, macAndData, pkt->payload_len - i);
-          if (len > 0) {  // success!
-            onGroupDataRecv(pkt, pkt->getPayloadType(), channels[j], data, len);
-            break;
+        // scan channels DB, for all matching hashes of 'channel_hash'
+        int num = searchChannelsByHash(&channel_hash);
+
+        // when hash collides, pre-check the first block of text msgs, and try the plausible channels first
+        bool precheck = num > 1 && pkt->getPayloadType() == PAYLOAD_TYPE_GRP_TXT
+                          && pkt->payload_len - i >= CIPHER_MAC_SIZE + CIPHER_BLOCK_SIZE;
+        bool found = false;
+        for (int pass = 0; pass < (precheck ? 2 : 1) && !found; pass++) {
+          // for each matching channel, try to decrypt data
+          for (int j = 0; j < num && !found; j++) {
+            const GroupChannel* channel = getMatchingChannel(j);
+            if (channel == NULL) continue;
+            if (precheck && isPlausibleGroupText(channel->secret, &macAndData[CIPHER_MAC_SIZE]) != (pass == 0)) continue;
+
+            // decrypt, checking MAC is valid
+            uint8_t data[MAX_PACKET_PAYLOAD];
+            _n_grp_mac_attempts++;
+            int len = Utils::MACThenDecrypt(channel->secret, data, macAndData, pkt->payload_len - i);
+            if (len > 0) {  // success!
+              _n_grp_decrypts++;
+              onGroupDataRecv(pkt, pkt->getPayloadType(), *channel, data, len);
+              found = true;
+            }
           }
         }
         action = routeRecvPacket(pkt);
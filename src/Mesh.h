@@ -2,6 +2,29 @@
 
 #include <Dispatcher.h>
 
+#ifndef CAD_BACKOFF_SLOT_MILLIS
+  #define CAD_BACKOFF_SLOT_MILLIS   50
+#endif
+#ifndef CAD_BACKOFF_CW_MIN
+  #define CAD_BACKOFF_CW_MIN         4    // slots
+#endif
+#ifndef CAD_BACKOFF_CW_MAX
+  #define CAD_BACKOFF_CW_MAX        64    // slots
+#endif
+
+#ifndef ANON_SECRET_CACHE_SIZE
+  #define ANON_SECRET_CACHE_SIZE   4    // recent ANON_REQ senders, to skip repeated key exchanges
+#endif
+#ifndef FLOOD_PATH_WINDOW_MILLIS
+  #define FLOOD_PATH_WINDOW_MILLIS   1000   // for sub-classes which opt in via getFloodPathWindow()
+#endif
+#ifndef FLOOD_PATH_MAX_HELD
+  #define FLOOD_PATH_MAX_HELD   4
+#endif
+#ifndef FLOOD_PATH_HOP_COST
+  #define FLOOD_PATH_HOP_COST   20   // SNR*4 units, ie. an extra hop must have a 5 dB better last link
+#endif
+
 namespace mesh {
 
 class GroupChannel {
@@ -28,6 +51,30 @@ class Mesh : public Dispatcher {
   RNG* _rng;
   MeshTables* _tables;
 
+  struct AnonSecret {
+    uint8_t sender_key[PUB_KEY_SIZE];
+    uint8_t secret[PUB_KEY_SIZE];
+  };
+  AnonSecret _anon_secrets[ANON_SECRET_CACHE_SIZE];
+  uint8_t _anon_self_key[PUB_KEY_SIZE];   // the self_id the cached secrets were calculated for
+  int _num_anon_secrets, _next_anon_secret;
+  uint32_t _n_peer_decrypts, _n_mac_attempts;   // for peer (REQ/RESPONSE/TXT_MSG/PATH) packets addressed to us
+  uint32_t _n_grp_decrypts, _n_grp_mac_attempts;
+
+  struct HeldFloodPacket {
+    Packet* packet;    // NULL if slot is free
+    unsigned long release_at;
+    uint8_t hash[MAX_HASH_SIZE];
+    int16_t score;     // of path currently in packet
+  };
+  HeldFloodPacket _held[FLOOD_PATH_MAX_HELD];
+  Packet* _replay_pkt;   // held packet currently being handled
+
+  void calcAnonSecret(uint8_t* secret, const Identity& sender);
+  bool isNewPacket(const Packet* packet) { return packet == _replay_pkt || !_tables->hasSeen(packet); }
+  bool holdForBestPath(Packet* packet);
+  bool updateHeldPath(const Packet* packet);
+  void releaseHeldPackets();
   void removeSelfFromPath(Packet* packet);
   void routeDirectRecvAcks(Packet* packet, uint32_t delay_millis);
   //void routeRecvAcks(Packet* packet, uint32_t delay_millis);
@@ -36,7 +83,11 @@ class Mesh : public Dispatcher {
 protected:
   DispatcherAction onRecvPacket(Packet* pkt) override;
 
-  virtual uint32_t getCADFailRetryDelay() const override;
+  /**
+   * \brief  randomised binary exponential backoff, in slots of CAD_BACKOFF_SLOT_MILLIS. Contention window starts at
+   *      CAD_BACKOFF_CW_MIN slots (more for lower priority packets), doubles on each consecutive fail, up to CAD_BACKOFF_CW_MAX.
+  */
+  virtual uint32_t getCADFailRetryDelay(uint8_t priority, int num_fails) const override;
 
   /**
    * \brief  Decide what to do with received packet, ie. discard, forward, or hold
@@ -65,10 +116,39 @@ protected:
   virtual uint8_t getExtraAckTransmitCount() const;
 
   /**
-   * \brief  Perform search of local DB of peers/contacts.
+   * \brief  'first packet wins' is replaced by 'best of N' for flood packets addressed to this node (which will likely
+   *         cause a path return). Copies are collected for this long, then the packet is handled with the best path,
+   *         scored by hop count and SNR of the final hop.
+   *         NOTE: this delays the handling (and ACK/response) of these packets, so is visible to senders, which need to
+   *         allow for it in their timeouts. Default is zero (disabled).
+   * \returns  number of milliseconds to collect copies of the given packet, or zero to handle first copy immediately
+   */
+  virtual uint32_t getFloodPathWindow(const Packet* packet) const;
+
+  /**
+   * \brief  Perform search of local DB of peers/contacts. ALL peers with matching hash should be returned, most likely
+   *         sender first (see sortPeerCandidates()), as each candidate costs a full MAC check.
+   * \param  packet  the received packet (for its path)
    * \returns  Number of peers with matching hash
    */
-  virtual int searchPeersByHash(const uint8_t* hash);
+  virtual int searchPeersByHash(const uint8_t* hash, const Packet* packet);
+
+  /**
+   * \brief  utility for searchPeersByHash() impls.
+   * \returns  true if (flood) packet came in via the reverse of given out_path, ie. is likely from that peer
+   */
+  static bool isReturnPath(const Packet* packet, const uint8_t* out_path, int8_t out_path_len);
+
+  /**
+   * \brief  utility for searchPeersByHash() impls. Path match ranks above any recency.
+   * \param  recency  any measure of peer's last activity (higher is more recent)
+   */
+  static uint32_t calcPeerRank(bool path_match, uint32_t recency) { return (path_match ? 0x80000000UL : 0) | (recency >> 1); }
+
+  /**
+   * \brief  utility for searchPeersByHash() impls. Sorts candidate indexes (and their ranks) by descending rank.
+   */
+  static void sortPeerCandidates(int* indexes, uint32_t* ranks, int n);
 
   /**
    * \brief  lookup the ECDH shared-secret between this node and peer by idx (calculate if necessary)
@@ -134,11 +214,16 @@ protected:
   virtual void onRawDataRecv(Packet* packet) { }
 
   /**
-   * \brief  Perform search of local DB of matching GroupChannels.
-   * \param  channels  OUT - store matching channels in this array, up to max_matches
+   * \brief  Perform search of local DB of matching GroupChannels. ALL channels with matching hash should be returned.
    * \returns  Number of channels with matching hash
    */
-  virtual int searchChannelsByHash(const uint8_t* hash, GroupChannel channels[], int max_matches);
+  virtual int searchChannelsByHash(const uint8_t* hash);
+
+  /**
+   * \brief  lookup a channel found by searchChannelsByHash()
+   * \param  match_idx  [0..n) where n is what searchChannelsByHash() returned
+   */
+  virtual const GroupChannel* getMatchingChannel(int match_idx) { return NULL; }
 
   /**
    * \brief  An encrypted group data packet has been received.
@@ -157,6 +242,11 @@ protected:
   Mesh(Radio& radio, MillisecondClock& ms, RNG& rng, RTCClock& rtc, PacketManager& mgr, MeshTables& tables)
     : Dispatcher(radio, ms, mgr), _rng(&rng), _rtc(&rtc), _tables(&tables)
   {
+    _num_anon_secrets = _next_anon_secret = 0;
+    _n_peer_decrypts = _n_mac_attempts = 0;
+    _n_grp_decrypts = _n_grp_mac_attempts = 0;
+    memset(_held, 0, sizeof(_held));
+    _replay_pkt = NULL;
   }
 
   MeshTables* getTables() const { return _tables; }
@@ -164,10 +254,18 @@ protected:
 public:
   void begin();
   void loop();
+  uint32_t getIdleMillis(uint32_t max_millis) const override;   // (also until next held flood packet is due)
 
   LocalIdentity self_id;
 
   RNG* getRNG() const { return _rng; }
+
+  uint32_t getNumPeerDecrypts() const { return _n_peer_decrypts; }
+  uint32_t getNumMACAttempts() const { return _n_mac_attempts; }
+  uint32_t getNumWastedMACAttempts() const { return _n_mac_attempts - _n_peer_decrypts; }   // failed attempts (hash collisions, or unknown sender)
+  uint32_t getNumGroupDecrypts() const { return _n_grp_decrypts; }
+  uint32_t getNumGroupMACAttempts() const { return _n_grp_mac_attempts; }
+  void resetPeerStats() { _n_peer_decrypts = _n_mac_attempts = _n_grp_decrypts = _n_grp_mac_attempts = 0; }
   RTCClock* getRTCClock() const { return _rtc; }
 
   Packet* createAdvert(const LocalIdentity& id, const uint8_t* app_data=NULL, size_t app_data_len=0);
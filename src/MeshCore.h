@@ -41,6 +41,8 @@ public:
   virtual void onAfterTransmit() { }
   virtual void reboot() = 0;
   virtual void powerOff() { /* no op */ }
+  virtual void sleep(uint32_t max_millis) { /* no op */ }   // light sleep, until radio interrupt or timeout
+  virtual bool checkRadioWakeup() { return false; }   // true (once) if sleep() woke on a radio interrupt that the ISR missed
   virtual uint8_t getStartupReason() const = 0;
   virtual bool startOTAUpdate(const char* id, char reply[]) { return false; }   // not supported
 };
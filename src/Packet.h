@@ -48,6 +48,7 @@ public:
   uint8_t path[MAX_PATH_SIZE];
   uint8_t payload[MAX_PACKET_PAYLOAD];
   int8_t _snr;
+  uint32_t _rx_micros;   // when reception completed (radio interrupt), by radio's micros clock. Zero if not received
 
   /**
    * \brief calculate the hash of payload + type
@@ -116,17 +116,22 @@ void BaseChatMesh::onAdvertRecv(mesh::Packet* packet, const mesh::Identity& id,
   }
   from->last_advert_timestamp = timestamp;
   from->lastmod = getRTCClock()->getCurrentTime();
+  touchContact(*from);
 
   onDiscoveredContact(*from, is_new, packet->path_len, packet->path);       // let UI know
 }
 
-int BaseChatMesh::searchPeersByHash(const uint8_t* hash) {
+int BaseChatMesh::searchPeersByHash(const uint8_t* hash, const mesh::Packet* packet) {
   int n = 0;
-  for (int i = 0; i < num_contacts && n < MAX_SEARCH_RESULTS; i++) {
-    if (contacts[i].id.isHashMatch(hash)) {
+  for (int i = 0; i < num_contacts; i++) {
+    auto c = &contacts[i];
+    if (c->id.isHashMatch(hash)) {
+      matching_peer_ranks[n] = calcPeerRank(isReturnPath(packet, c->out_path, c->out_path_len),
+                                            c->last_recv > c->lastmod ? c->last_recv : c->lastmod);
       matching_peer_indexes[n++] = i;  // store the INDEXES of matching contacts (for subsequent 'peer' methods)
     }
   }
+  sortPeerCandidates(matching_peer_indexes, matching_peer_ranks, n);
   return n;
 }
 
@@ -148,6 +153,7 @@ void BaseChatMesh::onPeerDataRecv(mesh::Packet* packet, uint8_t type, int sender
   }
 
   ContactInfo& from = contacts[i];
+  from.last_recv = getRTCClock()->getCurrentTime();
 
   if (type == PAYLOAD_TYPE_TXT_MSG && len > 5) {
     uint32_t timestamp;
@@ -234,11 +240,13 @@ bool BaseChatMesh::onPeerPathRecv(mesh::Packet* packet, int sender_idx, const ui
   }
 
   ContactInfo& from = contacts[i];
+  from.last_recv = getRTCClock()->getCurrentTime();
 
   // NOTE: for this impl, we just replace the current 'out_path' regardless, whenever sender sends us a new out_path.
   // FUTURE: could store multiple out_paths per contact, and try to find which is the 'best'(?)
   memcpy(from.out_path, path, from.out_path_len = path_len);  // store a copy of path, for sendDirect()
   from.lastmod = getRTCClock()->getCurrentTime();
+  touchContact(from);
 
   onContactPathUpdated(from);
 
@@ -261,15 +269,19 @@ void BaseChatMesh::onAckRecv(mesh::Packet* packet, uint32_t ack_crc) {
 }
 
 #ifdef MAX_GROUP_CHANNELS
-int BaseChatMesh::searchChannelsByHash(const uint8_t* hash, mesh::GroupChannel dest[], int max_matches) {
+int BaseChatMesh::searchChannelsByHash(const uint8_t* hash) {
   int n = 0;
-  for (int i = 0; i < MAX_GROUP_CHANNELS && n < max_matches; i++) {
+  for (uint8_t i = channel_buckets[hash[0] & (CHANNEL_HASH_BUCKETS - 1)]; i != 0xFF; i = channel_next[i]) {
     if (channels[i].channel.hash[0] == hash[0]) {
-      dest[n++] = channels[i].channel;
+      matching_channel_indexes[n++] = i;
     }
   }
   return n;
 }
+
+const mesh::GroupChannel* BaseChatMesh::getMatchingChannel(int match_idx) {
+  return &channels[matching_channel_indexes[match_idx]].channel;
+}
 #endif
 
 void BaseChatMesh::onGroupDataRecv(mesh::Packet* packet, uint8_t type, const mesh::GroupChannel& channel, uint8_t* data, size_t len) {
@@ -611,6 +623,7 @@ void BaseChatMesh::checkConnections() {
 
 void BaseChatMesh::resetPathTo(ContactInfo& recipient) {
   recipient.out_path_len = -1;
+  touchContact(recipient);
 }
 
 static ContactInfo* table;  // pass via global :-(
@@ -661,6 +674,8 @@ bool BaseChatMesh::addContact(const ContactInfo& contact) {
   if (num_contacts < MAX_CONTACTS) {
     auto dest = &contacts[num_contacts++];
     *dest = contact;
+    dest->last_recv = 0;
+    touchContact(*dest);
 
     // calc the ECDH shared secret (just once for performance)
     self_id.calcSharedSecret(dest->shared_secret, contact.id);
@@ -677,6 +692,13 @@ bool BaseChatMesh::removeContact(ContactInfo& contact) {
   }
   if (idx >= num_contacts) return false;   // not found
 
+  // record removal, for delta syncs
+  auto t = &tombstones[next_tombstone_idx];
+  if (t->change_seq) tombstone_floor_seq = t->change_seq;   // evicting oldest
+  memcpy(t->pub_key, contacts[idx].id.pub_key, PUB_KEY_SIZE);
+  t->change_seq = ++contacts_seq;
+  next_tombstone_idx = (next_tombstone_idx + 1) % MAX_CONTACT_TOMBSTONES;
+
   // remove from contacts array
   num_contacts--;
   while (idx < num_contacts) {
@@ -699,6 +721,7 @@ ChannelDetails* BaseChatMesh::addChannel(const char* name, const char* psk_base6
       mesh::Utils::sha256(dest->channel.hash, sizeof(dest->channel.hash), dest->channel.secret, len);
       StrHelper::strncpy(dest->name, name, sizeof(dest->name));
       num_channels++;
+      rebuildChannelIndex();
       return dest;
     }
   }
@@ -721,6 +744,7 @@ bool BaseChatMesh::setChannel(int idx, const ChannelDetails& src) {
     } else {
       mesh::Utils::sha256(channels[idx].channel.hash, sizeof(channels[idx].channel.hash), src.channel.secret, 32);  // 256-bit key
     }
+    rebuildChannelIndex();
     return true;
   }
   return false;
@@ -731,6 +755,18 @@ int BaseChatMesh::findChannelIdx(const mesh::GroupChannel& ch) {
   }
   return -1;  // not found
 }
+void BaseChatMesh::rebuildChannelIndex() {
+  static uint8_t zeroes[PUB_KEY_SIZE];
+
+  memset(channel_buckets, 0xFF, sizeof(channel_buckets));
+  for (int i = MAX_GROUP_CHANNELS - 1; i >= 0; i--) {   // push in reverse, so chains are in index order
+    if (memcmp(channels[i].channel.secret, zeroes, PUB_KEY_SIZE) == 0) continue;   // empty slot
+
+    uint8_t* head = &channel_buckets[channels[i].channel.hash[0] & (CHANNEL_HASH_BUCKETS - 1)];
+    channel_next[i] = *head;
+    *head = i;
+  }
+}
 #else
 ChannelDetails* BaseChatMesh::addChannel(const char* name, const char* psk_base64) {
   return NULL;  // not supported
@@ -753,6 +789,39 @@ bool BaseChatMesh::getContactByIdx(uint32_t idx, ContactInfo& contact) {
   return true;
 }
 
+const ContactTombstone* BaseChatMesh::getContactTombstone(int idx) const {
+  if (idx < 0 || idx >= MAX_CONTACT_TOMBSTONES || tombstones[idx].change_seq == 0) return NULL;
+  return &tombstones[idx];
+}
+
+static uint32_t fnv1a(uint32_t h, const uint8_t* data, int len) {
+  while (len-- > 0) {
+    h ^= *data++;
+    h *= 16777619;
+  }
+  return h;
+}
+
+uint32_t BaseChatMesh::calcContactsDigest() const {
+  uint32_t digest = num_contacts;
+  for (int i = 0; i < num_contacts; i++) {
+    auto c = &contacts[i];
+    uint32_t h = 2166136261;
+    h = fnv1a(h, c->id.pub_key, 8);
+    h = fnv1a(h, (const uint8_t *) &c->lastmod, 4);
+    h = fnv1a(h, &c->type, 1);
+    h = fnv1a(h, &c->flags, 1);
+    h = fnv1a(h, (const uint8_t *) &c->out_path_len, 1);
+    h = fnv1a(h, c->out_path, c->out_path_len > 0 ? c->out_path_len : 0);
+    h = fnv1a(h, (const uint8_t *) c->name, strnlen(c->name, sizeof(c->name)));
+    h = fnv1a(h, (const uint8_t *) &c->last_advert_timestamp, 4);
+    h = fnv1a(h, (const uint8_t *) &c->gps_lat, 4);
+    h = fnv1a(h, (const uint8_t *) &c->gps_lon, 4);
+    digest += h;   // order independent
+  }
+  return digest;
+}
+
 ContactsIterator BaseChatMesh::startContactsIterator() {
   return ContactsIterator();
 }
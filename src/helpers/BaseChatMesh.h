@@ -7,9 +7,16 @@
 
 #define MAX_TEXT_LEN    (10*CIPHER_BLOCK_SIZE)  // must be LESS than (MAX_PACKET_PAYLOAD - 4 - CIPHER_MAC_SIZE - 1)
 
-#include "ContactInfo.h"
+#ifdef MAX_GROUP_CHANNELS
+  #if MAX_GROUP_CHANNELS > 254
+    #error "MAX_GROUP_CHANNELS must be less than 255"
+  #endif
+  #ifndef CHANNEL_HASH_BUCKETS
+    #define CHANNEL_HASH_BUCKETS   32   // must be power of 2
+  #endif
+#endif
 
-#define MAX_SEARCH_RESULTS   8
+#include "ContactInfo.h"
 
 #define MSG_SEND_FAILED       0
 #define MSG_SEND_SENT_FLOOD   1
@@ -37,6 +44,15 @@ public:
   #define MAX_CONTACTS  32
 #endif
 
+#ifndef MAX_CONTACT_TOMBSTONES
+  #define MAX_CONTACT_TOMBSTONES  8
+#endif
+
+struct ContactTombstone {   // record of a removed contact, for delta syncs
+  uint8_t pub_key[PUB_KEY_SIZE];
+  uint32_t change_seq;
+};
+
 #ifndef MAX_CONNECTIONS
   #define MAX_CONNECTIONS  16
 #endif
@@ -60,12 +76,22 @@ class BaseChatMesh : public mesh::Mesh {
 
   ContactInfo contacts[MAX_CONTACTS];
   int num_contacts;
+  uint32_t contacts_seq;     // bumped on every change to contacts[]
+  ContactTombstone tombstones[MAX_CONTACT_TOMBSTONES];   // circular table
+  int next_tombstone_idx;
+  uint32_t tombstone_floor_seq;   // change_seq of most recently evicted tombstone
   int sort_array[MAX_CONTACTS];
-  int matching_peer_indexes[MAX_SEARCH_RESULTS];
+  int matching_peer_indexes[MAX_CONTACTS];   // NOTE: all matches, as 1-byte hashes often collide in larger contact lists
+  uint32_t matching_peer_ranks[MAX_CONTACTS];
   unsigned long txt_send_timeout;
 #ifdef MAX_GROUP_CHANNELS
   ChannelDetails channels[MAX_GROUP_CHANNELS];
   int num_channels;  // only for addChannel()
+  uint8_t channel_buckets[CHANNEL_HASH_BUCKETS];   // head of chain of channels[] indexes, by channel hash (0xFF = none)
+  uint8_t channel_next[MAX_GROUP_CHANNELS];        // next index in chain
+  uint8_t matching_channel_indexes[MAX_GROUP_CHANNELS];
+
+  void rebuildChannelIndex();
 #endif
   mesh::Packet* _pendingLoopback;
   uint8_t temp_buf[MAX_TRANS_UNIT];
@@ -79,9 +105,14 @@ protected:
       : mesh::Mesh(radio, ms, rng, rtc, mgr, tables)
   { 
     num_contacts = 0;
+    contacts_seq = 0;
+    memset(tombstones, 0, sizeof(tombstones));
+    next_tombstone_idx = 0;
+    tombstone_floor_seq = 0;
   #ifdef MAX_GROUP_CHANNELS
     memset(channels, 0, sizeof(channels));
     num_channels = 0;
+    memset(channel_buckets, 0xFF, sizeof(channel_buckets));
   #endif
     txt_send_timeout = 0;
     _pendingLoopback = NULL;
@@ -109,16 +140,20 @@ protected:
 
   // Mesh overrides
   void onAdvertRecv(mesh::Packet* packet, const mesh::Identity& id, uint32_t timestamp, const uint8_t* app_data, size_t app_data_len) override;
-  int searchPeersByHash(const uint8_t* hash) override;
+  int searchPeersByHash(const uint8_t* hash, const mesh::Packet* packet) override;
   void getPeerSharedSecret(uint8_t* dest_secret, int peer_idx) override;
   void onPeerDataRecv(mesh::Packet* packet, uint8_t type, int sender_idx, const uint8_t* secret, uint8_t* data, size_t len) override;
   bool onPeerPathRecv(mesh::Packet* packet, int sender_idx, const uint8_t* secret, uint8_t* path, uint8_t path_len, uint8_t extra_type, uint8_t* extra, uint8_t extra_len) override;
   void onAckRecv(mesh::Packet* packet, uint32_t ack_crc) override;
 #ifdef MAX_GROUP_CHANNELS
-  int searchChannelsByHash(const uint8_t* hash, mesh::GroupChannel channels[], int max_matches) override;
+  int searchChannelsByHash(const uint8_t* hash) override;
+  const mesh::GroupChannel* getMatchingChannel(int match_idx) override;
 #endif
   void onGroupDataRecv(mesh::Packet* packet, uint8_t type, const mesh::GroupChannel& channel, uint8_t* data, size_t len) override;
 
+  // sub-classes must call this when they modify a contact directly
+  void touchContact(ContactInfo& contact) { contact.change_seq = ++contacts_seq; }
+
   // Connections
   bool startConnection(const ContactInfo& contact, uint16_t keep_alive_secs);
   void stopConnection(const uint8_t* pub_key);
@@ -147,6 +182,18 @@ public:
   bool  addContact(const ContactInfo& contact);
   int getNumContacts() const { return num_contacts; }
   bool getContactByIdx(uint32_t idx, ContactInfo& contact);
+  uint32_t getContactsSeq() const { return contacts_seq; }
+  uint32_t calcContactsDigest() const;
+
+  /**
+   * \returns  true, if all contact changes (including removals) after 'since_seq' are still known
+   */
+  bool canDeltaSyncFrom(uint32_t since_seq) const { return since_seq <= contacts_seq && since_seq >= tombstone_floor_seq; }
+
+  /**
+   * \returns  removed contact at given idx of tombstones table, or NULL if empty slot. idx is [0..MAX_CONTACT_TOMBSTONES)
+   */
+  const ContactTombstone* getContactTombstone(int idx) const;
   ContactsIterator startContactsIterator();
   ChannelDetails* addChannel(const char* name, const char* psk_base64);
   bool getChannel(int idx, ChannelDetails& dest);
@@ -15,7 +15,12 @@ public:
 
   virtual bool isConnected() const = 0;
 
-  virtual bool isWriteBusy() const = 0;
+  virtual bool isWriteBusy() const = 0;   // (for multi-client interfaces, refers to current reply target)
+
+  /** \brief  for multi-client interfaces, identifies client which sent the most recently received frame */
+  virtual int getReplyTarget() const { return 0; }
+  /** \brief  directs following (non-push) frames to given client, eg. for later frames of a multi-frame reply */
+  virtual void setReplyTarget(int target) { }
   virtual size_t writeFrame(const uint8_t src[], size_t len) = 0;
   virtual size_t checkRecvFrame(uint8_t dest[]) = 0;
 };
@@ -58,6 +58,8 @@ void CommonCLI::loadPrefsInt(FILESYSTEM* fs, const char* filename) {
     file.read((uint8_t *) &_prefs->flood_max, sizeof(_prefs->flood_max));   // 124
     file.read((uint8_t *) &_prefs->flood_advert_interval, sizeof(_prefs->flood_advert_interval));  // 125
     file.read((uint8_t *) &_prefs->interference_threshold, sizeof(_prefs->interference_threshold));  // 126
+    file.read((uint8_t *) &_prefs->tpc_margin, sizeof(_prefs->tpc_margin));  // 127
+    file.read((uint8_t *) &_prefs->power_saving, sizeof(_prefs->power_saving));  // 128
 
     // sanitise bad pref values
     _prefs->rx_delay_base = constrain(_prefs->rx_delay_base, 0, 20.0f);
@@ -70,6 +72,8 @@ void CommonCLI::loadPrefsInt(FILESYSTEM* fs, const char* filename) {
     _prefs->cr = constrain(_prefs->cr, 5, 8);
     _prefs->tx_power_dbm = constrain(_prefs->tx_power_dbm, 1, 30);
     _prefs->multi_acks = constrain(_prefs->multi_acks, 0, 1);
+    _prefs->tpc_margin = constrain(_prefs->tpc_margin, 0, 30);
+    _prefs->power_saving = constrain(_prefs->power_saving, 0, 1);
 
     file.close();
   }
@@ -114,6 +118,8 @@ void CommonCLI::savePrefs(FILESYSTEM* fs) {
     file.write((uint8_t *) &_prefs->flood_max, sizeof(_prefs->flood_max));   // 124
     file.write((uint8_t *) &_prefs->flood_advert_interval, sizeof(_prefs->flood_advert_interval));  // 125
     file.write((uint8_t *) &_prefs->interference_threshold, sizeof(_prefs->interference_threshold));  // 126
+    file.write((uint8_t *) &_prefs->tpc_margin, sizeof(_prefs->tpc_margin));  // 127
+    file.write((uint8_t *) &_prefs->power_saving, sizeof(_prefs->power_saving));  // 128
 
     file.close();
   }
@@ -128,263 +134,501 @@ void CommonCLI::savePrefs() {
   _callbacks->savePrefs();
 }
 
-void CommonCLI::handleCommand(uint32_t sender_timestamp, const char* command, char* reply) {
-    if (memcmp(command, "reboot", 6) == 0) {
-      _board->reboot();  // doesn't return
-    } else if (memcmp(command, "advert", 6) == 0) {
-      _callbacks->sendSelfAdvertisement(1500);  // longer delay, give CLI response time to be sent first
-      strcpy(reply, "OK - Advert sent");
-    } else if (memcmp(command, "clock sync", 10) == 0) {
-      uint32_t curr = getRTCClock()->getCurrentTime();
-      if (sender_timestamp > curr) {
-        getRTCClock()->setCurrentTime(sender_timestamp + 1);
-        uint32_t now = getRTCClock()->getCurrentTime();
-        DateTime dt = DateTime(now);
-        sprintf(reply, "OK - clock set: %02d:%02d - %d/%d/%d UTC", dt.hour(), dt.minute(), dt.day(), dt.month(), dt.year());
-      } else {
-        strcpy(reply, "ERR: clock cannot go backwards");
-      }
-    } else if (memcmp(command, "start ota", 9) == 0) {
-      if (!_board->startOTAUpdate(_prefs->node_name, reply)) {
-        strcpy(reply, "Error");
-      }
-    } else if (memcmp(command, "clock", 5) == 0) {
-      uint32_t now = getRTCClock()->getCurrentTime();
-      DateTime dt = DateTime(now);
-      sprintf(reply, "%02d:%02d - %d/%d/%d UTC", dt.hour(), dt.minute(), dt.day(), dt.month(), dt.year());
-    } else if (memcmp(command, "time ", 5) == 0) {  // set time (to epoch seconds)
-      uint32_t secs = _atoi(&command[5]);
-      uint32_t curr = getRTCClock()->getCurrentTime();
-      if (secs > curr) {
-        getRTCClock()->setCurrentTime(secs);
-        uint32_t now = getRTCClock()->getCurrentTime();
-        DateTime dt = DateTime(now);
-        sprintf(reply, "OK - clock set: %02d:%02d - %d/%d/%d UTC", dt.hour(), dt.minute(), dt.day(), dt.month(), dt.year());
-      } else {
-        strcpy(reply, "(ERR: clock cannot go backwards)");
+// ---------- settings registry
+
+static void applyAdvertTimer(CommonCLICallbacks* callbacks, NodePrefs* prefs, char* reply) {
+  callbacks->updateAdvertTimer();
+}
+static void applyFloodAdvertTimer(CommonCLICallbacks* callbacks, NodePrefs* prefs, char* reply) {
+  callbacks->updateFloodAdvertTimer();
+}
+static void applyTxPower(CommonCLICallbacks* callbacks, NodePrefs* prefs, char* reply) {
+  callbacks->setTxPower(prefs->tx_power_dbm);
+}
+static void applyPowerSaving(CommonCLICallbacks* callbacks, NodePrefs* prefs, char* reply) {
+  callbacks->setPowerSaving(prefs->power_saving);
+}
+static void applyRepeat(CommonCLICallbacks* callbacks, NodePrefs* prefs, char* reply) {
+  strcpy(reply, prefs->disable_fwd ? "OK - repeat is now OFF" : "OK - repeat is now ON");
+}
+
+#define PREF(f)   offsetof(NodePrefs, f), sizeof(((NodePrefs *)0)->f)
+
+const CLISetting CommonCLI::_settings[] = {
+  //  id  name                     type               field                           scale  min    max     flags                                apply
+  {   1, "af",                    CLI_TYPE_FLOAT,    PREF(airtime_factor),           1,     0,     9,      0,                                   NULL },
+  {   2, "int.thresh",            CLI_TYPE_U8,       PREF(interference_threshold),   1,     0,     255,    0,                                   NULL },
+  {   3, "agc.reset.interval",    CLI_TYPE_U8,       PREF(agc_reset_interval),       4,     0,     255,    0,                                   NULL },
+  {   4, "multi.acks",            CLI_TYPE_U8,       PREF(multi_acks),               1,     0,     1,      0,                                   NULL },
+  {   5, "allow.read.only",       CLI_TYPE_BOOL,     PREF(allow_read_only),          1,     0,     1,      0,                                   NULL },
+  {   6, "flood.advert.interval", CLI_TYPE_U8,       PREF(flood_advert_interval),    1,     3,     48,     CLI_FLAG_ZERO_OK,                    applyFloodAdvertTimer },
+  {   7, "advert.interval",       CLI_TYPE_U8,       PREF(advert_interval),          2,     MIN_LOCAL_ADVERT_INTERVAL/2, 120, CLI_FLAG_ZERO_OK,  applyAdvertTimer },
+  {   8, "guest.password",        CLI_TYPE_STR,      PREF(guest_password),           1,     0,     0,      0,                                   NULL },
+  {   9, "name",                  CLI_TYPE_STR,      PREF(node_name),                1,     0,     0,      0,                                   NULL },
+  {  10, "repeat",                CLI_TYPE_BOOL_INV, PREF(disable_fwd),              1,     0,     1,      0,                                   applyRepeat },
+  {  11, "lat",                   CLI_TYPE_DOUBLE,   PREF(node_lat),                 1,     -90,   90,     0,                                   NULL },
+  {  12, "lon",                   CLI_TYPE_DOUBLE,   PREF(node_lon),                 1,     -180,  180,    0,                                   NULL },
+  {  13, "rxdelay",               CLI_TYPE_FLOAT,    PREF(rx_delay_base),            1,     0,     20,     0,                                   NULL },
+  {  14, "txdelay",               CLI_TYPE_FLOAT,    PREF(tx_delay_factor),          1,     0,     2,      0,                                   NULL },
+  {  15, "flood.max",             CLI_TYPE_U8,       PREF(flood_max),                1,     0,     64,     0,                                   NULL },
+  {  16, "direct.txdelay",        CLI_TYPE_FLOAT,    PREF(direct_tx_delay_factor),   1,     0,     2,      0,                                   NULL },
+  {  17, "tx",                    CLI_TYPE_U8,       PREF(tx_power_dbm),             1,     1,     30,     0,                                   applyTxPower },
+  {  18, "freq",                  CLI_TYPE_FLOAT,    PREF(freq),                     1,     400,   2500,   CLI_FLAG_LOCAL_ONLY | CLI_FLAG_REBOOT, NULL },
+  {  19, "bw",                    CLI_TYPE_FLOAT,    PREF(bw),                       1,     62.5,  500,    CLI_FLAG_REBOOT,                     NULL },
+  {  20, "sf",                    CLI_TYPE_U8,       PREF(sf),                       1,     7,     12,     CLI_FLAG_REBOOT,                     NULL },
+  {  21, "cr",                    CLI_TYPE_U8,       PREF(cr),                       1,     5,     8,      CLI_FLAG_REBOOT,                     NULL },
+  {  22, "tpc.margin",            CLI_TYPE_U8,       PREF(tpc_margin),               1,     3,     30,     CLI_FLAG_ZERO_OK,                    NULL },
+  {  23, "power.saving",          CLI_TYPE_BOOL,     PREF(power_saving),             1,     0,     1,      0,                                   applyPowerSaving },
+};
+#define NUM_SETTINGS   (sizeof(CommonCLI::_settings) / sizeof(CLISetting))
+
+const CLICommand CommonCLI::_commands[] = {
+  { "reboot",    &CommonCLI::cmdReboot },
+  { "advert",    &CommonCLI::cmdAdvert },
+  { "clock",     &CommonCLI::cmdClock },
+  { "start",     &CommonCLI::cmdStart },
+  { "time",      &CommonCLI::cmdTime },
+  { "neighbors", &CommonCLI::cmdNeighbors },
+  { "tempradio", &CommonCLI::cmdTempRadio },
+  { "password",  &CommonCLI::cmdPassword },
+  { "clear",     &CommonCLI::cmdClear },
+  { "get",       &CommonCLI::cmdGet },
+  { "set",       &CommonCLI::cmdSet },
+  { "erase",     &CommonCLI::cmdErase },
+  { "ver",       &CommonCLI::cmdVer },
+  { "log",       &CommonCLI::cmdLog },
+};
+#define NUM_COMMANDS   (sizeof(CommonCLI::_commands) / sizeof(CLICommand))
+
+static uint16_t nameHash(const char* name, int len) {   // FNV-1a, folded to 16 bits
+  uint32_t h = 2166136261UL;
+  for (int i = 0; i < len; i++) {
+    h ^= (uint8_t) name[i];
+    h *= 16777619UL;
+  }
+  return (h >> 16) ^ (h & 0xFFFF);
+}
+
+uint16_t CommonCLI::_setting_hashes[NUM_SETTINGS];
+uint16_t CommonCLI::_command_hashes[NUM_COMMANDS];
+bool CommonCLI::_hashes_ready = false;
+
+void CommonCLI::calcHashes() {
+  for (int i = 0; i < NUM_SETTINGS; i++) {
+    _setting_hashes[i] = nameHash(_settings[i].name, strlen(_settings[i].name));
+  }
+  for (int i = 0; i < NUM_COMMANDS; i++) {
+    _command_hashes[i] = nameHash(_commands[i].name, strlen(_commands[i].name));
+  }
+  _hashes_ready = true;
+}
+
+static bool nameEquals(const char* name, const char* s, int len) {
+  return memcmp(name, s, len) == 0 && name[len] == 0;
+}
+
+const CLISetting* CommonCLI::findSetting(const char* name, int name_len) {
+  if (!_hashes_ready) calcHashes();
+
+  uint16_t h = nameHash(name, name_len);
+  for (int i = 0; i < NUM_SETTINGS; i++) {
+    if (_setting_hashes[i] == h && nameEquals(_settings[i].name, name, name_len)) return &_settings[i];
+  }
+  return NULL;  // not found
+}
+
+const CLISetting* CommonCLI::findSettingById(uint8_t id) {
+  for (int i = 0; i < NUM_SETTINGS; i++) {
+    if (_settings[i].id == id) return &_settings[i];
+  }
+  return NULL;  // not found
+}
+
+const CLICommand* CommonCLI::findCommand(const char* name, int name_len) {
+  if (!_hashes_ready) calcHashes();
+
+  uint16_t h = nameHash(name, name_len);
+  for (int i = 0; i < NUM_COMMANDS; i++) {
+    if (_command_hashes[i] == h && nameEquals(_commands[i].name, name, name_len)) return &_commands[i];
+  }
+  return NULL;  // not found
+}
+
+static float getNumber(const CLISetting* s, const uint8_t* src) {
+  switch (s->type) {
+    case CLI_TYPE_FLOAT: { float f; memcpy(&f, src, sizeof(f)); return f; }
+    case CLI_TYPE_DOUBLE: { double d; memcpy(&d, src, sizeof(d)); return d; }
+    default: return *src;
+  }
+}
+
+void CommonCLI::formatSetting(const CLISetting* s, char* dest) {
+  const uint8_t* src = ((const uint8_t *) _prefs) + s->offset;
+  switch (s->type) {
+    case CLI_TYPE_U8:
+      sprintf(dest, "%d", ((uint32_t) *src) * s->scale);
+      break;
+    case CLI_TYPE_BOOL:
+      strcpy(dest, *src ? "on" : "off");
+      break;
+    case CLI_TYPE_BOOL_INV:
+      strcpy(dest, *src ? "off" : "on");
+      break;
+    case CLI_TYPE_FLOAT:
+    case CLI_TYPE_DOUBLE:
+      strcpy(dest, StrHelper::ftoa(getNumber(s, src)));
+      break;
+    case CLI_TYPE_STR:
+      strcpy(dest, (const char *) src);
+      break;
+  }
+}
+
+uint8_t CommonCLI::checkSetting(const CLISetting* s, const uint8_t* value, int len, bool is_local) {
+  if (s->flags & CLI_FLAG_READ_ONLY) return CLI_CFG_ERR_DENIED;
+  if ((s->flags & CLI_FLAG_LOCAL_ONLY) && !is_local) return CLI_CFG_ERR_DENIED;
+
+  if (s->type == CLI_TYPE_STR) return CLI_CFG_OK;   // (truncated if too long)
+  if (len != s->size) return CLI_CFG_ERR_LEN;
+
+  float v = getNumber(s, value);
+  if (!((v >= s->min_val && v <= s->max_val) || (v == 0 && (s->flags & CLI_FLAG_ZERO_OK)))) {  // NOTE: also catches NaN
+    return CLI_CFG_ERR_RANGE;
+  }
+  return CLI_CFG_OK;
+}
+
+uint8_t CommonCLI::writeSetting(const CLISetting* s, const uint8_t* value, int len, bool is_local) {
+  uint8_t status = checkSetting(s, value, len, is_local);
+  if (status != CLI_CFG_OK) return status;
+
+  uint8_t* dest = ((uint8_t *) _prefs) + s->offset;
+  if (s->type == CLI_TYPE_STR) {
+    if (len >= s->size) len = s->size - 1;   // truncate
+    memcpy(dest, value, len);
+    dest[len] = 0;
+  } else {
+    memcpy(dest, value, len);
+  }
+  return CLI_CFG_OK;
+}
+
+int CommonCLI::handleConfigRequest(const uint8_t* req, int req_len, uint8_t* reply, int reply_max) {
+  if (req_len < 1 || reply_max < 2) return 0;
+
+  uint8_t op = req[0];
+  reply[0] = op;
+  reply[1] = 0;   // flags
+  int ofs = 2;
+  int i = 1;
+  if (op == CLI_CFG_OP_GET) {
+    for ( ; i < req_len; i++) {
+      auto s = findSettingById(req[i]);
+      const uint8_t* src = s ? ((const uint8_t *) _prefs) + s->offset : NULL;
+      int len = 0;
+      if (s) {
+        len = s->type == CLI_TYPE_STR ? strlen((const char *) src) : s->size;
       }
-    } else if (memcmp(command, "neighbors", 9) == 0) {
-      _callbacks->formatNeighborsReply(reply);
-    } else if (memcmp(command, "tempradio ", 10) == 0) {
-      strcpy(tmp, &command[10]);
-      const char *parts[5];
-      int num = mesh::Utils::parseTextParts(tmp, parts, 5);
-      float freq  = num > 0 ? atof(parts[0]) : 0.0f;
-      float bw    = num > 1 ? atof(parts[1]) : 0.0f;
-      uint8_t sf  = num > 2 ? atoi(parts[2]) : 0;
-      uint8_t cr  = num > 3 ? atoi(parts[3]) : 0;
-      int temp_timeout_mins  = num > 4 ? atoi(parts[4]) : 0;
-      if (freq >= 300.0f && freq <= 2500.0f && sf >= 7 && sf <= 12 && cr >= 5 && cr <= 8 && bw >= 7.0f && bw <= 500.0f && temp_timeout_mins > 0) {
-        _callbacks->applyTempRadioParams(freq, bw, sf, cr, temp_timeout_mins);
-        sprintf(reply, "OK - temp params for %d mins", temp_timeout_mins);
-      } else {
-        strcpy(reply, "Error, invalid params");
+      if (ofs + 2 + len > reply_max) {
+        reply[1] |= CLI_CFG_FLAG_MORE;   // requester should ask for remainder in another request
+        break;
       }
-    } else if (memcmp(command, "password ", 9) == 0) {
-      // change admin password
-      StrHelper::strncpy(_prefs->password, &command[9], sizeof(_prefs->password));
-      savePrefs();
-      sprintf(reply, "password now: %s", _prefs->password);   // echo back just to let admin know for sure!!
-    } else if (memcmp(command, "clear stats", 11) == 0) {
-      _callbacks->clearStats();
-      strcpy(reply, "(OK - stats reset)");
-    } else if (memcmp(command, "get ", 4) == 0) {
-      const char* config = &command[4];
-      if (memcmp(config, "af", 2) == 0) {
-        sprintf(reply, "> %s", StrHelper::ftoa(_prefs->airtime_factor));
-      } else if (memcmp(config, "int.thresh", 10) == 0) {
-        sprintf(reply, "> %d", (uint32_t) _prefs->interference_threshold);
-      } else if (memcmp(config, "agc.reset.interval", 18) == 0) {
-        sprintf(reply, "> %d", ((uint32_t) _prefs->agc_reset_interval) * 4);
-      } else if (memcmp(config, "multi.acks", 10) == 0) {
-        sprintf(reply, "> %d", (uint32_t) _prefs->multi_acks);
-      } else if (memcmp(config, "allow.read.only", 15) == 0) {
-        sprintf(reply, "> %s", _prefs->allow_read_only ? "on" : "off");
-      } else if (memcmp(config, "flood.advert.interval", 21) == 0) {
-        sprintf(reply, "> %d", ((uint32_t) _prefs->flood_advert_interval));
-      } else if (memcmp(config, "advert.interval", 15) == 0) {
-        sprintf(reply, "> %d", ((uint32_t) _prefs->advert_interval) * 2);
-      } else if (memcmp(config, "guest.password", 14) == 0) {
-        sprintf(reply, "> %s", _prefs->guest_password);
-      } else if (memcmp(config, "name", 4) == 0) {
-        sprintf(reply, "> %s", _prefs->node_name);
-      } else if (memcmp(config, "repeat", 6) == 0) {
-        sprintf(reply, "> %s", _prefs->disable_fwd ? "off" : "on");
-      } else if (memcmp(config, "lat", 3) == 0) {
-        sprintf(reply, "> %s", StrHelper::ftoa(_prefs->node_lat));
-      } else if (memcmp(config, "lon", 3) == 0) {
-        sprintf(reply, "> %s", StrHelper::ftoa(_prefs->node_lon));
-      } else if (memcmp(config, "radio", 5) == 0) {
-        char freq[16], bw[16];
-        strcpy(freq, StrHelper::ftoa(_prefs->freq));
-        strcpy(bw, StrHelper::ftoa(_prefs->bw));
-        sprintf(reply, "> %s,%s,%d,%d", freq, bw, (uint32_t)_prefs->sf, (uint32_t)_prefs->cr);
-      } else if (memcmp(config, "rxdelay", 7) == 0) {
-        sprintf(reply, "> %s", StrHelper::ftoa(_prefs->rx_delay_base));
-      } else if (memcmp(config, "txdelay", 7) == 0) {
-        sprintf(reply, "> %s", StrHelper::ftoa(_prefs->tx_delay_factor));
-      } else if (memcmp(config, "flood.max", 9) == 0) {
-        sprintf(reply, "> %d", (uint32_t)_prefs->flood_max);
-      } else if (memcmp(config, "direct.txdelay", 14) == 0) {
-        sprintf(reply, "> %s", StrHelper::ftoa(_prefs->direct_tx_delay_factor));
-      } else if (memcmp(config, "tx", 2) == 0 && (config[2] == 0 || config[2] == ' ')) {
-        sprintf(reply, "> %d", (uint32_t) _prefs->tx_power_dbm);
-      } else if (memcmp(config, "freq", 4) == 0) {
-        sprintf(reply, "> %s", StrHelper::ftoa(_prefs->freq));
-      } else if (memcmp(config, "public.key", 10) == 0) {
-        strcpy(reply, "> ");
-        mesh::Utils::toHex(&reply[2], _callbacks->getSelfIdPubKey(), PUB_KEY_SIZE);
-      } else if (memcmp(config, "role", 4) == 0) {
-        sprintf(reply, "> %s", _callbacks->getRole());
-      } else {
-        sprintf(reply, "??: %s", config);
+      reply[ofs++] = req[i];
+      reply[ofs++] = len;
+      memcpy(&reply[ofs], src, len); ofs += len;
+    }
+  } else if (op == CLI_CFG_OP_SET) {
+    // first pass: check whole batch, so it is applied all or nothing
+    bool all_ok = true;
+    for (int j = i; j < req_len; j += 2 + req[j + 1]) {
+      if (j + 2 > req_len || j + 2 + req[j + 1] > req_len) return 0;   // malformed
+      if (ofs + 2 > reply_max) return 0;   // too many items for one request
+
+      auto s = findSettingById(req[j]);
+      uint8_t status = s ? checkSetting(s, &req[j + 2], req[j + 1], false) : CLI_CFG_ERR_UNKNOWN;
+      if (status != CLI_CFG_OK) all_ok = false;
+      reply[ofs++] = req[j];
+      reply[ofs++] = status;
+    }
+    if (!all_ok) {
+      for (int k = 3; k < ofs; k += 2) {
+        if (reply[k] == CLI_CFG_OK) reply[k] = CLI_CFG_ERR_ABORTED;
       }
-    } else if (memcmp(command, "set ", 4) == 0) {
-      const char* config = &command[4];
-      if (memcmp(config, "af ", 3) == 0) {
-        _prefs->airtime_factor = atof(&config[3]);
-        savePrefs();
-        strcpy(reply, "OK");
-      } else if (memcmp(config, "int.thresh ", 11) == 0) {
-        _prefs->interference_threshold = atoi(&config[11]);
-        savePrefs();
-        strcpy(reply, "OK");
-      } else if (memcmp(config, "agc.reset.interval ", 19) == 0) {
-        _prefs->agc_reset_interval = atoi(&config[19]) / 4;
-        savePrefs();
-        strcpy(reply, "OK");
-      } else if (memcmp(config, "multi.acks ", 11) == 0) {
-        _prefs->multi_acks = atoi(&config[11]);
-        savePrefs();
-        strcpy(reply, "OK");
-      } else if (memcmp(config, "allow.read.only ", 16) == 0) {
-        _prefs->allow_read_only = memcmp(&config[16], "on", 2) == 0;
-        savePrefs();
-        strcpy(reply, "OK");
-      } else if (memcmp(config, "flood.advert.interval ", 22) == 0) {
-        int hours = _atoi(&config[22]);
-        if ((hours > 0 && hours < 3) || (hours > 48)) {
-          strcpy(reply, "Error: interval range is 3-48 hours");
-        } else {
-          _prefs->flood_advert_interval = (uint8_t)(hours);
-          _callbacks->updateFloodAdvertTimer();
-          savePrefs();
-          strcpy(reply, "OK");
-        }
-      } else if (memcmp(config, "advert.interval ", 16) == 0) {
-        int mins = _atoi(&config[16]);
-        if ((mins > 0 && mins < MIN_LOCAL_ADVERT_INTERVAL) || (mins > 240)) {
-          sprintf(reply, "Error: interval range is %d-240 minutes", MIN_LOCAL_ADVERT_INTERVAL);
-        } else {
-          _prefs->advert_interval = (uint8_t)(mins / 2);
-          _callbacks->updateAdvertTimer();
-          savePrefs();
-          strcpy(reply, "OK");
-        }
-      } else if (memcmp(config, "guest.password ", 15) == 0) {
-        StrHelper::strncpy(_prefs->guest_password, &config[15], sizeof(_prefs->guest_password));
-        savePrefs();
-        strcpy(reply, "OK");
-      } else if (memcmp(config, "name ", 5) == 0) {
-        StrHelper::strncpy(_prefs->node_name, &config[5], sizeof(_prefs->node_name));
-        savePrefs();
-        strcpy(reply, "OK");
-      } else if (memcmp(config, "repeat ", 7) == 0) {
-        _prefs->disable_fwd = memcmp(&config[7], "off", 3) == 0;
-        savePrefs();
-        strcpy(reply, _prefs->disable_fwd ? "OK - repeat is now OFF" : "OK - repeat is now ON");
-      } else if (memcmp(config, "radio ", 6) == 0) {
-        strcpy(tmp, &config[6]);
-        const char *parts[4];
-        int num = mesh::Utils::parseTextParts(tmp, parts, 4);
-        float freq  = num > 0 ? atof(parts[0]) : 0.0f;
-        float bw    = num > 1 ? atof(parts[1]) : 0.0f;
-        uint8_t sf  = num > 2 ? atoi(parts[2]) : 0;
-        uint8_t cr  = num > 3 ? atoi(parts[3]) : 0;
-        if (freq >= 300.0f && freq <= 2500.0f && sf >= 7 && sf <= 12 && cr >= 5 && cr <= 8 && bw >= 7.0f && bw <= 500.0f) {
-          _prefs->sf = sf;
-          _prefs->cr = cr;
-          _prefs->freq = freq;
-          _prefs->bw = bw;
-          _callbacks->savePrefs();
-          strcpy(reply, "OK - reboot to apply");
-        } else {
-          strcpy(reply, "Error, invalid radio params");
-        }
-      } else if (memcmp(config, "lat ", 4) == 0) {
-        _prefs->node_lat = atof(&config[4]);
-        savePrefs();
-        strcpy(reply, "OK");
-      } else if (memcmp(config, "lon ", 4) == 0) {
-        _prefs->node_lon = atof(&config[4]);
-        savePrefs();
-        strcpy(reply, "OK");
-      } else if (memcmp(config, "rxdelay ", 8) == 0) {
-        float db = atof(&config[8]);
-        if (db >= 0) {
-          _prefs->rx_delay_base = db;
-          savePrefs();
-          strcpy(reply, "OK");
-        } else {
-          strcpy(reply, "Error, cannot be negative");
-        }
-      } else if (memcmp(config, "txdelay ", 8) == 0) {
-        float f = atof(&config[8]);
-        if (f >= 0) {
-          _prefs->tx_delay_factor = f;
-          savePrefs();
-          strcpy(reply, "OK");
-        } else {
-          strcpy(reply, "Error, cannot be negative");
-        }
-      } else if (memcmp(config, "flood.max ", 10) == 0) {
-        uint8_t m = atoi(&config[10]);
-        if (m <= 64) {
-          _prefs->flood_max = m;
-          savePrefs();
-          strcpy(reply, "OK");
-        } else {
-          strcpy(reply, "Error, max 64");
-        }
-      } else if (memcmp(config, "direct.txdelay ", 15) == 0) {
-        float f = atof(&config[15]);
-        if (f >= 0) {
-          _prefs->direct_tx_delay_factor = f;
-          savePrefs();
-          strcpy(reply, "OK");
-        } else {
-          strcpy(reply, "Error, cannot be negative");
-        }
-      } else if (memcmp(config, "tx ", 3) == 0) {
-        _prefs->tx_power_dbm = atoi(&config[3]);
-        savePrefs();
-        _callbacks->setTxPower(_prefs->tx_power_dbm);
-        strcpy(reply, "OK");
-      } else if (sender_timestamp == 0 && memcmp(config, "freq ", 5) == 0) {
-        _prefs->freq = atof(&config[5]);
-        savePrefs();
-        strcpy(reply, "OK - reboot to apply");
-      } else {
-        sprintf(reply, "unknown config: %s", config);
+      return ofs;
+    }
+
+    // second pass: apply
+    while (i < req_len) {
+      auto s = findSettingById(req[i]);
+      uint8_t len = req[i + 1];
+      writeSetting(s, &req[i + 2], len, false);
+      i += 2 + len;
+      if (s->flags & CLI_FLAG_REBOOT) reply[1] |= CLI_CFG_FLAG_REBOOT;
+      if (s->apply) s->apply(_callbacks, _prefs, tmp);
+    }
+    if (ofs > 2) savePrefs();   // just one save, for whole batch
+  } else if (op == CLI_CFG_OP_LIST) {
+    for (int idx = req_len > 1 ? req[1] : 0; idx < NUM_SETTINGS; idx++) {
+      auto s = &_settings[idx];
+      int name_len = strlen(s->name);
+      if (ofs + 3 + name_len > reply_max) {
+        reply[1] |= CLI_CFG_FLAG_MORE;
+        break;
       }
-    } else if (sender_timestamp == 0 && strcmp(command, "erase") == 0) {
-      bool s = _callbacks->formatFileSystem();
-      sprintf(reply, "File system erase: %s", s ? "OK" : "Err");
-    } else if (memcmp(command, "ver", 3) == 0) {
-      sprintf(reply, "%s (Build: %s)", _callbacks->getFirmwareVer(), _callbacks->getBuildDate());
-    } else if (memcmp(command, "log start", 9) == 0) {
-      _callbacks->setLoggingOn(true);
-      strcpy(reply, "   logging on");
-    } else if (memcmp(command, "log stop", 8) == 0) {
-      _callbacks->setLoggingOn(false);
-      strcpy(reply, "   logging off");
-    } else if (memcmp(command, "log erase", 9) == 0) {
-      _callbacks->eraseLogFile();
-      strcpy(reply, "   log erased");
-    } else if (sender_timestamp == 0 && memcmp(command, "log", 3) == 0) {
-      _callbacks->dumpLogFile();
-      strcpy(reply, "   EOF");
+      reply[ofs++] = s->id;
+      reply[ofs++] = s->type;
+      reply[ofs++] = name_len;
+      memcpy(&reply[ofs], s->name, name_len); ofs += name_len;
+    }
+  } else {
+    return 0;  // unknown op
+  }
+  return ofs;
+}
+
+// ---------- text commands
+
+void CommonCLI::handleCommand(uint32_t sender_timestamp, const char* command, char* reply) {
+  int len = 0;
+  while (command[len] && command[len] != ' ') len++;
+  const char* args = &command[len];
+  while (*args == ' ') args++;
+
+  auto cmd = findCommand(command, len);
+  if (cmd) {
+    (this->*cmd->handler)(sender_timestamp, args, reply);
+  } else {
+    strcpy(reply, "Unknown command");
+  }
+}
+
+static void formatClock(uint32_t now, char* dest) {
+  DateTime dt = DateTime(now);
+  sprintf(dest, "%02d:%02d - %d/%d/%d UTC", dt.hour(), dt.minute(), dt.day(), dt.month(), dt.year());
+}
+
+void CommonCLI::cmdReboot(uint32_t sender_timestamp, const char* args, char* reply) {
+  _board->reboot();  // doesn't return
+}
+
+void CommonCLI::cmdAdvert(uint32_t sender_timestamp, const char* args, char* reply) {
+  _callbacks->sendSelfAdvertisement(1500);  // longer delay, give CLI response time to be sent first
+  strcpy(reply, "OK - Advert sent");
+}
+
+void CommonCLI::cmdClock(uint32_t sender_timestamp, const char* args, char* reply) {
+  if (memcmp(args, "sync", 4) == 0) {
+    uint32_t curr = getRTCClock()->getCurrentTime();
+    if (sender_timestamp > curr) {
+      getRTCClock()->setCurrentTime(sender_timestamp + 1);
+      strcpy(reply, "OK - clock set: ");
+      formatClock(getRTCClock()->getCurrentTime(), &reply[16]);
+    } else {
+      strcpy(reply, "ERR: clock cannot go backwards");
+    }
+  } else {
+    formatClock(getRTCClock()->getCurrentTime(), reply);
+  }
+}
+
+void CommonCLI::cmdStart(uint32_t sender_timestamp, const char* args, char* reply) {
+  if (memcmp(args, "ota", 3) == 0) {
+    if (!_board->startOTAUpdate(_prefs->node_name, reply)) {
+      strcpy(reply, "Error");
+    }
+  } else {
+    strcpy(reply, "Unknown command");
+  }
+}
+
+void CommonCLI::cmdTime(uint32_t sender_timestamp, const char* args, char* reply) {  // set time (to epoch seconds)
+  uint32_t secs = _atoi(args);
+  uint32_t curr = getRTCClock()->getCurrentTime();
+  if (secs > curr) {
+    getRTCClock()->setCurrentTime(secs);
+    strcpy(reply, "OK - clock set: ");
+    formatClock(getRTCClock()->getCurrentTime(), &reply[16]);
+  } else {
+    strcpy(reply, "(ERR: clock cannot go backwards)");
+  }
+}
+
+void CommonCLI::cmdNeighbors(uint32_t sender_timestamp, const char* args, char* reply) {
+  _callbacks->formatNeighborsReply(reply);
+}
+
+void CommonCLI::cmdTempRadio(uint32_t sender_timestamp, const char* args, char* reply) {
+  StrHelper::strncpy(tmp, args, sizeof(tmp));
+  const char *parts[5];
+  int num = mesh::Utils::parseTextParts(tmp, parts, 5);
+  float freq  = num > 0 ? atof(parts[0]) : 0.0f;
+  float bw    = num > 1 ? atof(parts[1]) : 0.0f;
+  uint8_t sf  = num > 2 ? atoi(parts[2]) : 0;
+  uint8_t cr  = num > 3 ? atoi(parts[3]) : 0;
+  int temp_timeout_mins  = num > 4 ? atoi(parts[4]) : 0;
+  if (freq >= 300.0f && freq <= 2500.0f && sf >= 7 && sf <= 12 && cr >= 5 && cr <= 8 && bw >= 7.0f && bw <= 500.0f && temp_timeout_mins > 0) {
+    _callbacks->applyTempRadioParams(freq, bw, sf, cr, temp_timeout_mins);
+    sprintf(reply, "OK - temp params for %d mins", temp_timeout_mins);
+  } else {
+    strcpy(reply, "Error, invalid params");
+  }
+}
+
+void CommonCLI::cmdPassword(uint32_t sender_timestamp, const char* args, char* reply) {
+  // change admin password
+  StrHelper::strncpy(_prefs->password, args, sizeof(_prefs->password));
+  savePrefs();
+  sprintf(reply, "password now: %s", _prefs->password);   // echo back just to let admin know for sure!!
+}
+
+void CommonCLI::cmdClear(uint32_t sender_timestamp, const char* args, char* reply) {
+  if (memcmp(args, "stats", 5) == 0) {
+    _callbacks->clearStats();
+    strcpy(reply, "(OK - stats reset)");
+  } else {
+    strcpy(reply, "Unknown command");
+  }
+}
+
+void CommonCLI::cmdGet(uint32_t sender_timestamp, const char* config, char* reply) {
+  int len = 0;
+  while (config[len] && config[len] != ' ') len++;
+
+  auto s = findSetting(config, len);
+  if (s) {
+    strcpy(reply, "> ");
+    formatSetting(s, &reply[2]);
+  } else if (memcmp(config, "radio", 5) == 0) {
+    char freq[16], bw[16];
+    strcpy(freq, StrHelper::ftoa(_prefs->freq));
+    strcpy(bw, StrHelper::ftoa(_prefs->bw));
+    sprintf(reply, "> %s,%s,%d,%d", freq, bw, (uint32_t)_prefs->sf, (uint32_t)_prefs->cr);
+  } else if (memcmp(config, "public.key", 10) == 0) {
+    strcpy(reply, "> ");
+    mesh::Utils::toHex(&reply[2], _callbacks->getSelfIdPubKey(), PUB_KEY_SIZE);
+  } else if (memcmp(config, "role", 4) == 0) {
+    sprintf(reply, "> %s", _callbacks->getRole());
+  } else {
+    sprintf(reply, "??: %s", config);
+  }
+}
+
+void CommonCLI::cmdSet(uint32_t sender_timestamp, const char* config, char* reply) {
+  int len = 0;
+  while (config[len] && config[len] != ' ') len++;
+  const char* value = &config[len];
+  if (*value == ' ') value++;
+
+  if (memcmp(config, "radio ", 6) == 0) {
+    StrHelper::strncpy(tmp, value, sizeof(tmp));
+    const char *parts[4];
+    int num = mesh::Utils::parseTextParts(tmp, parts, 4);
+    float freq  = num > 0 ? atof(parts[0]) : 0.0f;
+    float bw    = num > 1 ? atof(parts[1]) : 0.0f;
+    uint8_t sf  = num > 2 ? atoi(parts[2]) : 0;
+    uint8_t cr  = num > 3 ? atoi(parts[3]) : 0;
+    if (freq >= 400.0f && freq <= 2500.0f && sf >= 7 && sf <= 12 && cr >= 5 && cr <= 8 && bw >= 62.5f && bw <= 500.0f) {   // same bounds as loadPrefs()
+      _prefs->sf = sf;
+      _prefs->cr = cr;
+      _prefs->freq = freq;
+      _prefs->bw = bw;
+      _callbacks->savePrefs();
+      strcpy(reply, "OK - reboot to apply");
+    } else {
+      strcpy(reply, "Error, invalid radio params");
+    }
+    return;
+  }
+
+  auto s = *value ? findSetting(config, len) : NULL;
+  if (s == NULL || (s->flags & CLI_FLAG_READ_ONLY)) {
+    sprintf(reply, "unknown config: %s", config);
+    return;
+  }
+
+  // convert text to stored (binary) form, then validate + store same as binary requests
+  uint8_t raw[8];
+  const uint8_t* src = raw;
+  int src_len = s->size;
+  uint8_t status = CLI_CFG_OK;
+  switch (s->type) {
+    case CLI_TYPE_U8: {
+      uint32_t n = _atoi(value);
+      uint32_t v = n / s->scale;
+      if (v > 255 || (v == 0 && n > 0)) status = CLI_CFG_ERR_RANGE;   // don't let a small value round down to zero (ie. off)
+      raw[0] = v;
+      break;
+    }
+    case CLI_TYPE_BOOL:
+      raw[0] = memcmp(value, "on", 2) == 0;
+      break;
+    case CLI_TYPE_BOOL_INV:
+      raw[0] = memcmp(value, "off", 3) == 0;
+      break;
+    case CLI_TYPE_FLOAT: {
+      float f = atof(value);
+      memcpy(raw, &f, sizeof(f));
+      break;
+    }
+    case CLI_TYPE_DOUBLE: {
+      double d = atof(value);
+      memcpy(raw, &d, sizeof(d));
+      break;
+    }
+    case CLI_TYPE_STR:
+      src = (const uint8_t *) value;
+      src_len = strlen(value);
+      break;
+  }
+  if (status == CLI_CFG_OK) {
+    status = writeSetting(s, src, src_len, sender_timestamp == 0);
+  }
+
+  if (status == CLI_CFG_OK) {
+    strcpy(reply, (s->flags & CLI_FLAG_REBOOT) ? "OK - reboot to apply" : "OK");
+    if (s->apply) s->apply(_callbacks, _prefs, reply);
+    savePrefs();
+  } else if (status == CLI_CFG_ERR_RANGE) {
+    const char* or_zero = (s->flags & CLI_FLAG_ZERO_OK) ? " (or 0)" : "";
+    if (s->type == CLI_TYPE_U8) {
+      sprintf(reply, "Error, range is %d-%d%s", (int)s->min_val * s->scale, (int)s->max_val * s->scale, or_zero);
     } else {
-      strcpy(reply, "Unknown command");
+      char lo[16];
+      strcpy(lo, StrHelper::ftoa(s->min_val));
+      sprintf(reply, "Error, range is %s-%s%s", lo, StrHelper::ftoa(s->max_val), or_zero);
     }
+  } else {
+    sprintf(reply, "unknown config: %s", config);   // eg. local only setting
+  }
+}
+
+void CommonCLI::cmdErase(uint32_t sender_timestamp, const char* args, char* reply) {
+  if (sender_timestamp == 0 && *args == 0) {
+    bool s = _callbacks->formatFileSystem();
+    sprintf(reply, "File system erase: %s", s ? "OK" : "Err");
+  } else {
+    strcpy(reply, "Unknown command");
+  }
+}
+
+void CommonCLI::cmdVer(uint32_t sender_timestamp, const char* args, char* reply) {
+  sprintf(reply, "%s (Build: %s)", _callbacks->getFirmwareVer(), _callbacks->getBuildDate());
+}
+
+void CommonCLI::cmdLog(uint32_t sender_timestamp, const char* args, char* reply) {
+  if (memcmp(args, "start", 5) == 0) {
+    _callbacks->setLoggingOn(true);
+    strcpy(reply, "   logging on");
+  } else if (memcmp(args, "stop", 4) == 0) {
+    _callbacks->setLoggingOn(false);
+    strcpy(reply, "   logging off");
+  } else if (memcmp(args, "erase", 5) == 0) {
+    _callbacks->eraseLogFile();
+    strcpy(reply, "   log erased");
+  } else if (sender_timestamp == 0) {
+    _callbacks->dumpLogFile();
+    strcpy(reply, "   EOF");
+  } else {
+    strcpy(reply, "Unknown command");
+  }
 }
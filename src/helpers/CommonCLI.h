@@ -26,6 +26,8 @@ struct NodePrefs {  // persisted to file
     uint8_t flood_max;
     uint8_t interference_threshold;
     uint8_t agc_reset_interval;   // secs / 4
+    uint8_t tpc_margin;   // dB, for transmit power control of direct packets. zero = disabled
+    uint8_t power_saving;   // duty-cycled receive, and MCU sleep when idle
 };
 
 class CommonCLICallbacks {
@@ -46,6 +48,64 @@ public:
   virtual const uint8_t* getSelfIdPubKey() = 0;
   virtual void clearStats() = 0;
   virtual void applyTempRadioParams(float freq, float bw, uint8_t sf, uint8_t cr, int timeout_mins) = 0;
+  virtual void setPowerSaving(bool enable) { }   // not supported by default
+};
+
+// value types of CLISetting
+#define CLI_TYPE_U8        1
+#define CLI_TYPE_BOOL      2   // 'on' / 'off'
+#define CLI_TYPE_BOOL_INV  3   // 'on' / 'off', but stored inverted (eg. repeat -> disable_fwd)
+#define CLI_TYPE_FLOAT     4
+#define CLI_TYPE_DOUBLE    5
+#define CLI_TYPE_STR       6
+
+// CLISetting flags
+#define CLI_FLAG_READ_ONLY   0x01
+#define CLI_FLAG_LOCAL_ONLY  0x02   // can only be set from local serial console
+#define CLI_FLAG_REBOOT      0x04   // only takes effect after reboot
+#define CLI_FLAG_ZERO_OK     0x08   // zero (ie. 'off') is allowed, in addition to [min, max]
+
+typedef void (*CLIApplyFn)(CommonCLICallbacks* callbacks, NodePrefs* prefs, char* reply);
+
+/**
+ * \brief  One entry in the settings registry. Text 'get'/'set' and the binary config request are both driven
+ *          from the same table, so a new NodePrefs field only needs a single line to be exposed by both.
+*/
+struct CLISetting {
+  uint8_t id;         // stable ID, used by binary config requests. NEVER re-use
+  const char* name;   // as used by 'get'/'set' text commands
+  uint8_t type;       // CLI_TYPE_*
+  uint8_t offset;     // offsetof(NodePrefs, field)
+  uint8_t size;       // sizeof field
+  uint8_t scale;      // text value = stored value * scale  (CLI_TYPE_U8 only)
+  float min_val, max_val;   // in stored units
+  uint8_t flags;      // CLI_FLAG_*
+  CLIApplyFn apply;   // optional, called after value changed (reply is pre-set to "OK")
+};
+
+// binary config request (REQ_TYPE_CONFIG). Values are raw NodePrefs fields, little-endian, in stored units.
+//   req:   [op=GET] [id]*                  reply: [op] [flags] ([id] [len] [value])*   len=0 if unknown
+//   req:   [op=SET] ([id] [len] [value])*  reply: [op] [flags] ([id] [status])*   all items are applied, or none
+#define CLI_CFG_OP_GET       1
+#define CLI_CFG_OP_SET       2
+#define CLI_CFG_OP_LIST      3   // req: [op] [start_idx]   reply: [op] [flags] ([id] [type] [name_len] [name])*
+
+#define CLI_CFG_FLAG_REBOOT  0x01   // (reply flags) one or more changes need a reboot
+#define CLI_CFG_FLAG_MORE    0x02   // (reply flags) LIST: more entries remain, or GET: reply truncated
+
+#define CLI_CFG_OK           0
+#define CLI_CFG_ERR_UNKNOWN  1
+#define CLI_CFG_ERR_LEN      2
+#define CLI_CFG_ERR_RANGE    3
+#define CLI_CFG_ERR_DENIED   4
+#define CLI_CFG_ERR_ABORTED  5   // (SET) item was valid, but not applied as another item in the batch failed
+
+class CommonCLI;
+typedef void (CommonCLI::*CLICmdHandler)(uint32_t sender_timestamp, const char* args, char* reply);
+
+struct CLICommand {
+  const char* name;    // first word of command
+  CLICmdHandler handler;
 };
 
 class CommonCLI {
@@ -59,6 +119,37 @@ class CommonCLI {
   void savePrefs();
   void loadPrefsInt(FILESYSTEM* _fs, const char* filename);
 
+  static const CLISetting _settings[];
+  static const CLICommand _commands[];
+
+  static uint16_t _setting_hashes[];   // calculated on first lookup
+  static uint16_t _command_hashes[];
+  static bool _hashes_ready;
+  static void calcHashes();
+
+  static const CLISetting* findSetting(const char* name, int name_len);
+  static const CLISetting* findSettingById(uint8_t id);
+  static const CLICommand* findCommand(const char* name, int name_len);
+  void formatSetting(const CLISetting* s, char* dest);
+  uint8_t checkSetting(const CLISetting* s, const uint8_t* value, int len, bool is_local);
+  uint8_t writeSetting(const CLISetting* s, const uint8_t* value, int len, bool is_local);
+
+  // command handlers
+  void cmdReboot(uint32_t sender_timestamp, const char* args, char* reply);
+  void cmdAdvert(uint32_t sender_timestamp, const char* args, char* reply);
+  void cmdClock(uint32_t sender_timestamp, const char* args, char* reply);
+  void cmdStart(uint32_t sender_timestamp, const char* args, char* reply);
+  void cmdTime(uint32_t sender_timestamp, const char* args, char* reply);
+  void cmdNeighbors(uint32_t sender_timestamp, const char* args, char* reply);
+  void cmdTempRadio(uint32_t sender_timestamp, const char* args, char* reply);
+  void cmdPassword(uint32_t sender_timestamp, const char* args, char* reply);
+  void cmdClear(uint32_t sender_timestamp, const char* args, char* reply);
+  void cmdGet(uint32_t sender_timestamp, const char* args, char* reply);
+  void cmdSet(uint32_t sender_timestamp, const char* args, char* reply);
+  void cmdErase(uint32_t sender_timestamp, const char* args, char* reply);
+  void cmdVer(uint32_t sender_timestamp, const char* args, char* reply);
+  void cmdLog(uint32_t sender_timestamp, const char* args, char* reply);
+
 public:
   CommonCLI(mesh::MainBoard& board, mesh::RTCClock& rtc, NodePrefs* prefs, CommonCLICallbacks* callbacks)
       : _board(&board), _rtc(&rtc), _prefs(prefs), _callbacks(callbacks) { }
@@ -66,4 +157,10 @@ public:
   void loadPrefs(FILESYSTEM* _fs);
   void savePrefs(FILESYSTEM* _fs);
   void handleCommand(uint32_t sender_timestamp, const char* command, char* reply);
+
+  /**
+   * \brief  handles a binary (multi) get/set of settings, see CLI_CFG_OP_*.
+   * \returns  length of reply, or zero if request is invalid
+  */
+  int handleConfigRequest(const uint8_t* req, int req_len, uint8_t* reply, int reply_max);
 };
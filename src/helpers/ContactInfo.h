@@ -15,4 +15,6 @@ struct ContactInfo {
   uint32_t lastmod;  // by OUR clock
   int32_t gps_lat, gps_lon;    // 6 dec places
   uint32_t sync_since;
+  uint32_t change_seq;   // from BaseChatMesh's contacts_seq (RAM only, for delta syncs)
+  uint32_t last_recv;    // by OUR clock, when last packet was decrypted from them (RAM only)
 };
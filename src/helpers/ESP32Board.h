@@ -8,10 +8,19 @@
 #include <rom/rtc.h>
 #include <sys/time.h>
 #include <Wire.h>
+#include <esp_sleep.h>
+#include <driver/uart.h>
+#include <soc/gpio_struct.h>
+
+#ifndef SLEEP_SERIAL_AWAKE_MILLIS
+  #define SLEEP_SERIAL_AWAKE_MILLIS   60000   // after serial input wakes us
+#endif
 
 class ESP32Board : public mesh::MainBoard {
 protected:
   uint8_t startup_reason;
+  bool _radio_wakeup = false;
+  unsigned long _serial_awake_until = 0;
 
 public:
   void begin() {
@@ -86,6 +95,47 @@ public:
     esp_restart();
   }
 
+#ifdef P_LORA_DIO_1
+  void sleep(uint32_t max_millis) override {
+    if (digitalRead(P_LORA_DIO_1) == HIGH) return;   // radio interrupt is already pending
+  #if ARDUINO_USB_CDC_ON_BOOT
+    if (Serial) return;   // USB host attached, light sleep would drop the CDC link
+  #else
+    if ((long)(millis() - _serial_awake_until) < 0) return;   // CLI session in progress
+  #endif
+
+    gpio_num_t dio1 = (gpio_num_t)P_LORA_DIO_1;
+    uint32_t intr_type = GPIO.pin[dio1].int_type;   // as set by RadioLib's attachInterrupt()
+    gpio_intr_disable(dio1);   // wakeup needs a HIGH level type, which would otherwise re-fire the ISR until packet is read
+
+    esp_sleep_enable_timer_wakeup((uint64_t)max_millis * 1000);
+    gpio_wakeup_enable(dio1, GPIO_INTR_HIGH_LEVEL);  // wake on radio interrupt (RxDone, etc)
+    esp_sleep_enable_gpio_wakeup();
+  #if !ARDUINO_USB_CDC_ON_BOOT
+    uart_set_wakeup_threshold(UART_NUM_0, 3);   // NOTE: the chars which wake us are lost
+    esp_sleep_enable_uart_wakeup(UART_NUM_0);
+  #endif
+    esp_light_sleep_start();   // NOTE: RAM, peripherals and millis() are all retained
+
+    gpio_wakeup_disable(dio1);
+    gpio_set_intr_type(dio1, (gpio_int_type_t) intr_type);
+    gpio_intr_enable(dio1);
+    if (digitalRead(P_LORA_DIO_1) == HIGH) _radio_wakeup = true;   // edge was while ISR disabled
+  #if !ARDUINO_USB_CDC_ON_BOOT
+    if (esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_UART) {
+      _serial_awake_until = millis() + SLEEP_SERIAL_AWAKE_MILLIS;   // stay awake for rest of CLI input
+    }
+  #endif
+    esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_ALL);
+  }
+
+  bool checkRadioWakeup() override {
+    bool woke = _radio_wakeup;
+    _radio_wakeup = false;
+    return woke;
+  }
+#endif
+
   bool startOTAUpdate(const char* id, char reply[]) override;
 };
 
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "BaseSerialInterface.h"
+
+#ifndef FRAME_QUEUE_SIZE
+  #define FRAME_QUEUE_SIZE  16
+#endif
+
+/**
+ * \brief  Fixed size ring of serial frames. Safe for one producer and one consumer running in different
+ *     contexts (eg. a BLE stack callback and the main loop), as each side only moves its own index.
+*/
+class FrameQueue {
+  struct Frame {
+    uint8_t len;
+    uint8_t buf[MAX_FRAME_SIZE];
+  };
+
+  Frame _frames[FRAME_QUEUE_SIZE + 1];   // one slot always left empty, to tell full from empty
+  volatile uint16_t _head, _tail;
+
+  static uint16_t next(uint16_t idx) { return idx >= FRAME_QUEUE_SIZE ? 0 : idx + 1; }
+
+public:
+  FrameQueue() { _head = _tail = 0; }
+
+  void clear() { _head = _tail; }
+  bool isEmpty() const { return _head == _tail; }
+  bool isFull() const { return next(_tail) == _head; }
+  int count() const { return _tail >= _head ? _tail - _head : (FRAME_QUEUE_SIZE + 1) - (_head - _tail); }
+
+  bool push(const uint8_t src[], size_t len) {
+    if (len > MAX_FRAME_SIZE || isFull()) return false;
+
+    Frame* f = &_frames[_tail];
+    f->len = len;
+    memcpy(f->buf, src, len);
+    _tail = next(_tail);   // publish, only after frame is complete
+    return true;
+  }
+
+  // NOTE: only valid when !isEmpty()
+  const uint8_t* peekBuf() const { return _frames[_head].buf; }
+  size_t peekLen() const { return _frames[_head].len; }
+
+  void pop() { if (!isEmpty()) _head = next(_head); }
+
+  size_t pop(uint8_t dest[]) {
+    if (isEmpty()) return 0;
+
+    size_t len = _frames[_head].len;
+    memcpy(dest, _frames[_head].buf, len);
+    _head = next(_head);
+    return len;
+  }
+};
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#ifndef NOISE_FLOOR_WINDOW
+  #define NOISE_FLOOR_WINDOW       128   // number of RSSI samples in sliding window
+#endif
+#ifndef NOISE_FLOOR_PERCENTILE
+  #define NOISE_FLOOR_PERCENTILE    20   // floor is this percentile of the window
+#endif
+#ifndef NOISE_FLOOR_MIN_SAMPLES
+  #define NOISE_FLOOR_MIN_SAMPLES   16   // before floor is considered valid
+#endif
+#ifndef NOISE_FLOOR_QUIET_SPREAD
+  #define NOISE_FLOOR_QUIET_SPREAD  14   // samples within this many dB above floor count as 'quiet' (for variance)
+#endif
+
+#define NOISE_FLOOR_MIN_RSSI   -140
+#define NOISE_FLOOR_NUM_BINS    128    // 1 dB bins, from NOISE_FLOOR_MIN_RSSI
+
+/**
+ * \brief  Always-on noise floor estimator. Keeps a sliding window of RSSI samples (taken while no packet is being
+ *         received), with a histogram of the window so the floor can be a low percentile, rather than a mean which
+ *         gets dragged up by interference. Samples well above the floor are counted as interference bursts.
+*/
+class NoiseFloorTracker {
+  int8_t _samples[NOISE_FLOOR_WINDOW];   // ring buffer, dBm
+  uint16_t _bins[NOISE_FLOOR_NUM_BINS];  // histogram of _samples
+  int _count, _next;
+  int16_t _floor;
+  float _variance;
+  int _burst_threshold;
+  bool _in_burst;
+  uint32_t _num_bursts, _num_burst_samples, _total_samples;
+  int16_t _burst_peak;
+
+  static int toBin(int rssi) {
+    int b = rssi - NOISE_FLOOR_MIN_RSSI;
+    return b < 0 ? 0 : (b >= NOISE_FLOOR_NUM_BINS ? NOISE_FLOOR_NUM_BINS - 1 : b);
+  }
+
+  void recalc() {
+    int target = (_count * NOISE_FLOOR_PERCENTILE + 99) / 100;
+    if (target < 1) target = 1;
+
+    int b = 0, n = 0;
+    while (b < NOISE_FLOOR_NUM_BINS - 1 && n + _bins[b] < target) { n += _bins[b]; b++; }
+    _floor = NOISE_FLOOR_MIN_RSSI + b;
+
+    // variance of the 'quiet' samples, ie. ignoring interference
+    int top = toBin(_floor + NOISE_FLOOR_QUIET_SPREAD);
+    int32_t num = 0, sum = 0, sum_sq = 0;
+    for (int i = 0; i <= top; i++) {
+      if (_bins[i] == 0) continue;
+      int d = i - b;   // relative to floor, to keep sums small
+      num += _bins[i];
+      sum += d * _bins[i];
+      sum_sq += d * d * _bins[i];
+    }
+    float mean = (float)sum / num;
+    _variance = (float)sum_sq / num - mean*mean;
+  }
+
+public:
+  NoiseFloorTracker() { _burst_threshold = NOISE_FLOOR_QUIET_SPREAD; reset(); }
+
+  void reset() {
+    memset(_bins, 0, sizeof(_bins));
+    _count = _next = 0;
+    _floor = 0;
+    _variance = 0;
+    _in_burst = false;
+    resetStats();
+  }
+
+  void resetStats() {
+    _num_bursts = _num_burst_samples = _total_samples = 0;
+    _burst_peak = NOISE_FLOOR_MIN_RSSI;
+  }
+
+  /** \brief  samples more than this many dB above the floor are interference */
+  void setBurstThreshold(int db) { _burst_threshold = db; }
+
+  void addSample(int rssi) {
+    if (isValid()) {   // classify against floor from previous samples
+      _total_samples++;
+      if (rssi > _floor + _burst_threshold) {
+        if (!_in_burst) { _in_burst = true; _num_bursts++; }
+        _num_burst_samples++;
+        if (rssi > _burst_peak) _burst_peak = rssi;
+      } else {
+        _in_burst = false;
+      }
+    }
+
+    if (_count == NOISE_FLOOR_WINDOW) {
+      _bins[toBin(_samples[_next])]--;   // drop oldest sample
+    } else {
+      _count++;
+    }
+    int b = toBin(rssi);
+    _samples[_next] = NOISE_FLOOR_MIN_RSSI + b;
+    _bins[b]++;
+    _next = (_next + 1) % NOISE_FLOOR_WINDOW;
+
+    recalc();
+  }
+
+  bool isValid() const { return _count >= NOISE_FLOOR_MIN_SAMPLES; }
+  int getNumSamples() const { return _count; }
+
+  /** \returns  current floor estimate in dBm, or zero if not enough samples yet */
+  int getFloor() const { return isValid() ? _floor : 0; }
+
+  /** \returns  variance (dB^2) of the non-interference samples in the window */
+  float getVariance() const { return _variance; }
+
+  bool isInBurst() const { return _in_burst; }
+  uint32_t getNumBursts() const { return _num_bursts; }
+  uint32_t getNumBurstSamples() const { return _num_burst_samples; }
+  uint32_t getNumClassifiedSamples() const { return _total_samples; }
+  int getBurstPeak() const { return _burst_peak; }
+};
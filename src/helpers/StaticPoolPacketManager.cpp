@@ -17,6 +17,22 @@ int PacketQueue::countBefore(uint32_t now) const {
   return n;
 }
 
+int PacketQueue::nextPriority(uint32_t now) const {
+  int min_pri = -1;
+  for (int j = 0; j < _num; j++) {
+    if (_schedule_table[j] > now) continue;   // scheduled for future... ignore for now
+    if (min_pri < 0 || _pri_table[j] < min_pri) min_pri = _pri_table[j];
+  }
+  return min_pri;
+}
+
+bool PacketQueue::nextScheduled(uint32_t& scheduled_for) const {
+  for (int j = 0; j < _num; j++) {
+    if (j == 0 || (long)(_schedule_table[j] - scheduled_for) < 0) scheduled_for = _schedule_table[j];
+  }
+  return _num > 0;
+}
+
 mesh::Packet* PacketQueue::get(uint32_t now) {
   uint8_t min_pri = 0xFF;
   int best_idx = -1;
@@ -94,6 +110,10 @@ int  StaticPoolPacketManager::getOutboundCount(uint32_t now) const {
   return send_queue.countBefore(now);
 }
 
+int StaticPoolPacketManager::getNextOutboundPriority(uint32_t now) const {
+  return send_queue.nextPriority(now);
+}
+
 int StaticPoolPacketManager::getFreeCount() const {
   return unused.count();
 }
@@ -111,3 +131,7 @@ void StaticPoolPacketManager::queueInbound(mesh::Packet* packet, uint32_t schedu
 mesh::Packet* StaticPoolPacketManager::getNextInbound(uint32_t now) {
   return rx_queue.get(now);
 }
+
+bool StaticPoolPacketManager::getNextInboundTime(uint32_t& scheduled_for) const {
+  return rx_queue.nextScheduled(scheduled_for);
+}
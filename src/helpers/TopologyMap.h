@@ -0,0 +1,209 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+
+#ifndef TOPO_MAX_LINKS
+  #define TOPO_MAX_LINKS      64
+#endif
+#ifndef TOPO_MAX_AGE_SECS
+  #define TOPO_MAX_AGE_SECS   (6*60*60)   // links not re-measured in this long are dropped
+#endif
+
+#define TOPO_FRAME_VERSION     1
+#define TOPO_FRAME_HEADER_SIZE 4    // version, total links, offset, count
+#define TOPO_LINK_REC_SIZE     5    // from, to, snr, age (minutes), num samples
+
+#define TOPO_TRACE_PUSH_CODE   0x89   // companion PUSH_CODE_TRACE_DATA
+
+struct TopoLink {
+  uint8_t  from, to;     // node hashes (pub_key[0]). Direction is from transmitter to receiver
+  int8_t   snr;          // as heard by 'to', SNR*4, smoothed
+  uint8_t  num_samples;
+  uint32_t updated;      // RTC secs, zero if slot is free
+};
+
+/**
+ * \brief  Aggregates per-hop link measurements (TRACE results, repeater neighbour tables) into a directed link graph,
+ *         with ageing. No Arduino dependencies, so the same code can be used host-side, eg. to replay recorded trace
+ *         frames, or to decode the exported frames.
+ *         NOTE: nodes are only identified by hash, so colliding hashes will merge their links.
+*/
+class TopologyMap {
+  TopoLink _links[TOPO_MAX_LINKS];
+
+  bool isLive(const TopoLink& l, uint32_t now) const { return l.updated > 0 && now - l.updated < TOPO_MAX_AGE_SECS; }
+
+  TopoLink* findLink(uint8_t from, uint8_t to, uint32_t now, bool create) {
+    TopoLink* oldest = &_links[0];
+    for (int i = 0; i < TOPO_MAX_LINKS; i++) {
+      auto l = &_links[i];
+      if (l->from == from && l->to == to && isLive(*l, now)) return l;
+      if (l->updated < oldest->updated) oldest = l;
+    }
+    if (!create) return NULL;
+
+    memset(oldest, 0, sizeof(*oldest));
+    oldest->from = from;
+    oldest->to = to;
+    return oldest;
+  }
+
+  const TopoLink* getLink(uint8_t from, uint8_t to, uint32_t now) const {
+    for (int i = 0; i < TOPO_MAX_LINKS; i++) {
+      auto l = &_links[i];
+      if (l->from == from && l->to == to && isLive(*l, now)) return l;
+    }
+    return NULL;
+  }
+
+public:
+  TopologyMap() { clear(); }
+
+  void clear() { memset(_links, 0, sizeof(_links)); }
+
+  /** \brief  merge one link measurement. 'measured_at' can be older than 'now', eg. from neighbour tables */
+  void addLink(uint8_t from, uint8_t to, int8_t snr, uint32_t measured_at, uint32_t now) {
+    if (from == to || now - measured_at >= TOPO_MAX_AGE_SECS) return;
+
+    auto l = findLink(from, to, now, true);
+    if (l->num_samples > 0 && measured_at < l->updated) return;   // already have newer
+
+    l->snr = l->num_samples == 0 ? snr : (int8_t) ((l->snr * 3 + snr) / 4);
+    if (l->num_samples < 255) l->num_samples++;
+    l->updated = measured_at;
+  }
+
+  /**
+   * \brief  merge result of a TRACE, which went out from self_hash through path_hashes, then back to self.
+   * \param  path_snrs  SNR*4 each hop heard previous hop with (as per onTraceRecv())
+   * \param  final_snr  SNR*4 the trace was received back with
+  */
+  void addTrace(uint8_t self_hash, const uint8_t* path_hashes, const uint8_t* path_snrs, uint8_t path_len, int8_t final_snr, uint32_t now) {
+    uint8_t prev = self_hash;
+    for (int i = 0; i < path_len; i++) {
+      addLink(prev, path_hashes[i], (int8_t) path_snrs[i], now, now);
+      prev = path_hashes[i];
+    }
+    if (path_len > 0) addLink(prev, self_hash, final_snr, now, now);
+  }
+
+  /**
+   * \brief  merge a (recorded) trace push frame from companion radio: [code][reserved][path_len][flags][tag:4][auth:4][hashes][snrs][final_snr]
+   * \returns  false if frame is invalid
+  */
+  bool addTraceFrame(uint8_t self_hash, const uint8_t* frame, int len, uint32_t now) {
+    if (len < 12 || frame[0] != TOPO_TRACE_PUSH_CODE) return false;
+    uint8_t path_len = frame[2];
+    if (len < 12 + 2*path_len + 1) return false;
+
+    addTrace(self_hash, &frame[12], &frame[12 + path_len], path_len, (int8_t) frame[12 + 2*path_len], now);
+    return true;
+  }
+
+  /**
+   * \brief  merge a repeater's reply to the 'neighbors' CLI command, lines of: {pub_key hex}:{secs ago}:{snr*4}
+   * \returns  number of links merged
+  */
+  int addNeighboursReply(uint8_t repeater_hash, const char* reply, uint32_t now) {
+    int n = 0;
+    const char* sp = reply;
+    while (*sp) {
+      char* ep;
+      uint8_t hash = strtoul(sp, &ep, 16) >> 24;   // first byte of 4-byte hex prefix
+      if (ep - sp == 8 && *ep == ':') {
+        uint32_t secs_ago = strtoul(ep + 1, &ep, 10);
+        if (*ep == ':') {
+          int snr = strtol(ep + 1, &ep, 10);
+          addLink(hash, repeater_hash, (int8_t) snr, now - secs_ago, now);   // repeater heard neighbour
+          n++;
+        }
+      }
+      while (*ep && *ep != '\n') ep++;   // next line
+      sp = *ep ? ep + 1 : ep;
+    }
+    return n;
+  }
+
+  int getNumLinks(uint32_t now) const {
+    int n = 0;
+    for (int i = 0; i < TOPO_MAX_LINKS; i++) {
+      if (isLive(_links[i], now)) n++;
+    }
+    return n;
+  }
+
+  /** \returns  number of distinct nodes with a live link to or from given node */
+  int getDegree(uint8_t hash, uint32_t now) const {
+    uint8_t seen[32];   // bitset of neighbour hashes
+    memset(seen, 0, sizeof(seen));
+    int n = 0;
+    for (int i = 0; i < TOPO_MAX_LINKS; i++) {
+      auto l = &_links[i];
+      if (!isLive(*l, now) || (l->from != hash && l->to != hash)) continue;
+      uint8_t other = l->from == hash ? l->to : l->from;
+      if ((seen[other >> 3] & (1 << (other & 7))) == 0) {
+        seen[other >> 3] |= 1 << (other & 7);
+        n++;
+      }
+    }
+    return n;
+  }
+
+  /**
+   * \brief  compares both directions of a link
+   * \param  diff  OUT - SNR*4 of a->b minus b->a
+   * \returns  false if either direction is not known
+  */
+  bool getAsymmetry(uint8_t a, uint8_t b, uint32_t now, int& diff) const {
+    auto ab = getLink(a, b, now);
+    auto ba = getLink(b, a, now);
+    if (ab == NULL || ba == NULL) return false;
+    diff = ab->snr - ba->snr;
+    return true;
+  }
+
+  /**
+   * \brief  exports live links, starting from the offset'th, as: [version][total][offset][count] then count x [from][to][snr][age mins][samples]
+   * \returns  bytes written to dest
+  */
+  int writeFrame(uint8_t* dest, int max_len, int offset, uint32_t now) const {
+    int total = 0, count = 0;
+    int i = TOPO_FRAME_HEADER_SIZE;
+    for (int k = 0; k < TOPO_MAX_LINKS; k++) {
+      auto l = &_links[k];
+      if (!isLive(*l, now)) continue;
+      if (total++ < offset || i + TOPO_LINK_REC_SIZE > max_len) continue;
+
+      uint32_t mins = (now - l->updated) / 60;
+      dest[i++] = l->from;
+      dest[i++] = l->to;
+      dest[i++] = (uint8_t) l->snr;
+      dest[i++] = mins > 255 ? 255 : mins;
+      dest[i++] = l->num_samples;
+      count++;
+    }
+    dest[0] = TOPO_FRAME_VERSION;
+    dest[1] = total > 255 ? 255 : total;
+    dest[2] = offset;
+    dest[3] = count;
+    return i;
+  }
+
+  /**
+   * \brief  merges links from a frame made by writeFrame() (eg. host-side, from several nodes' exports)
+   * \returns  number of links merged, or -1 if frame is invalid
+  */
+  int readFrame(const uint8_t* src, int len, uint32_t now) {
+    if (len < TOPO_FRAME_HEADER_SIZE || src[0] != TOPO_FRAME_VERSION) return -1;
+    int count = src[3];
+    if (len < TOPO_FRAME_HEADER_SIZE + count*TOPO_LINK_REC_SIZE) return -1;
+
+    const uint8_t* sp = &src[TOPO_FRAME_HEADER_SIZE];
+    for (int k = 0; k < count; k++, sp += TOPO_LINK_REC_SIZE) {
+      addLink(sp[0], sp[1], (int8_t) sp[2], now - sp[3]*60, now);
+    }
+    return count;
+  }
+};
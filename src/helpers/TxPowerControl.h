@@ -0,0 +1,170 @@
+#pragma once
+
+#include <Packet.h>
+#include <string.h>
+
+#ifndef TPC_MAX_LINKS
+  #define TPC_MAX_LINKS          16
+#endif
+#ifndef TPC_MAX_REDUCTION_DB
+  #define TPC_MAX_REDUCTION_DB   12    // never go more than this below configured power
+#endif
+#ifndef TPC_MAX_AGE_SECS
+  #define TPC_MAX_AGE_SECS       (15*60)   // link measurements older than this are ignored
+#endif
+#define TPC_MIN_RX_SAMPLES        3
+
+#define TRACE_PAYLOAD_HEADER_SIZE   9    // tag(4), auth_code(4), flags(1), then hashes of path
+
+struct TPCLink {
+  uint8_t  hash;         // neighbour's pub_key[0]
+  uint8_t  num_rx;       // number of samples in rx_snr
+  int8_t   rx_snr;       // how well WE hear THEM, SNR*4, smoothed
+  int8_t   fwd_snr;      // how well THEY heard US (from TRACE packets), SNR*4
+  uint8_t  fwd_power;    // dBm we transmitted at, when fwd_snr was measured. Zero if no fwd_snr
+  uint8_t  tx_power;     // dBm we last chose for this neighbour
+  uint32_t rx_time, fwd_time;   // RTC secs
+
+  uint32_t lastUsed() const { return rx_time > fwd_time ? rx_time : fwd_time; }
+};
+
+/**
+ * \brief  Closed-loop transmit power control, for direct (routed) packets. Tracks link SNR of each next-hop neighbour,
+ *         and picks the lowest TX power which keeps a given margin above the demodulation threshold for the SF.
+ *         Flood packets, and packets to unknown neighbours, always go at the configured power.
+ *         NOTE: neighbours are only identified by hash, so colliding hashes just make the estimate more conservative.
+*/
+class TxPowerControl {
+  TPCLink _links[TPC_MAX_LINKS];
+  uint8_t _cur_power;    // what radio is currently set to, zero if unknown
+
+  TPCLink* findLink(uint8_t hash, bool create) {
+    TPCLink* oldest = &_links[0];
+    for (int i = 0; i < TPC_MAX_LINKS; i++) {
+      if (_links[i].hash == hash && _links[i].lastUsed() > 0) return &_links[i];
+      if (_links[i].lastUsed() < oldest->lastUsed()) oldest = &_links[i];
+    }
+    if (!create) return NULL;
+
+    memset(oldest, 0, sizeof(*oldest));
+    oldest->hash = hash;
+    return oldest;
+  }
+
+  void addRxSample(uint8_t hash, int8_t snr, uint32_t now) {
+    auto link = findLink(hash, true);
+    if (link->num_rx == 0 || snr < link->rx_snr) {
+      link->rx_snr = snr;   // drops are believed straight away
+    } else {
+      link->rx_snr = (link->rx_snr * 3 + snr) / 4;   // improvements only slowly
+    }
+    if (link->num_rx < 255) link->num_rx++;
+    link->rx_time = now;
+  }
+
+  static bool getLastHop(const mesh::Packet* pkt, uint8_t& hash) {
+    if (pkt->isRouteFlood()) {
+      if (pkt->path_len > 0) {
+        hash = pkt->path[pkt->path_len - 1];
+        return true;
+      }
+      switch (pkt->getPayloadType()) {   // zero hop, so is from the originator
+        case PAYLOAD_TYPE_ADVERT:
+          hash = pkt->payload[0]; return true;    // pub_key
+        case PAYLOAD_TYPE_REQ: case PAYLOAD_TYPE_RESPONSE: case PAYLOAD_TYPE_TXT_MSG:
+        case PAYLOAD_TYPE_PATH: case PAYLOAD_TYPE_ANON_REQ:
+          hash = pkt->payload[1]; return true;    // src_hash, or start of sender pub_key
+      }
+    }
+    return false;  // (direct packets don't say who the previous hop was)
+  }
+
+  static bool getNextHop(const mesh::Packet* pkt, uint8_t& hash) {
+    if (!pkt->isRouteDirect()) return false;
+
+    if (pkt->getPayloadType() == PAYLOAD_TYPE_TRACE) {
+      int i = TRACE_PAYLOAD_HEADER_SIZE + pkt->path_len;
+      if (i >= pkt->payload_len) return false;
+      hash = pkt->payload[i];
+      return true;
+    }
+    if (pkt->path_len > 0) {
+      hash = pkt->path[0];
+      return true;
+    }
+    switch (pkt->getPayloadType()) {   // last hop, so is the destination
+      case PAYLOAD_TYPE_REQ: case PAYLOAD_TYPE_RESPONSE: case PAYLOAD_TYPE_TXT_MSG:
+      case PAYLOAD_TYPE_PATH: case PAYLOAD_TYPE_ANON_REQ:
+        hash = pkt->payload[0]; return true;    // dest_hash
+    }
+    return false;
+  }
+
+public:
+  TxPowerControl() { memset(_links, 0, sizeof(_links)); _cur_power = 0; }
+
+  /** \brief  SNR (dB) needed to demodulate, per SF (as per Semtech datasheets) */
+  static float getSNRThreshold(int sf) { return -7.5f - 2.5f*(sf - 7); }
+
+  /** \brief  to be called when app sets the radio's TX power directly, eg. from CLI */
+  void setCurrentPower(uint8_t dbm) { _cur_power = dbm; }
+
+  /** \brief  to be called for every received packet */
+  void onRecv(const mesh::Packet* pkt, uint8_t self_hash, uint32_t now) {
+    uint8_t hash;
+    if (getLastHop(pkt, hash)) {
+      addRxSample(hash, pkt->_snr, now);
+    }
+
+    if (pkt->isRouteDirect() && pkt->getPayloadType() == PAYLOAD_TYPE_TRACE) {
+      const uint8_t* hashes = &pkt->payload[TRACE_PAYLOAD_HEADER_SIZE];
+      int num_hashes = pkt->payload_len - TRACE_PAYLOAD_HEADER_SIZE;
+      int n = pkt->path_len < num_hashes ? pkt->path_len : num_hashes;   // path[] has SNR each hop heard prev hop with
+
+      if (n < num_hashes && hashes[n] == self_hash && n > 0) {
+        addRxSample(hashes[n - 1], pkt->_snr, now);   // we're next in trace, so know who sent it
+      }
+      for (int j = 1; j < n; j++) {
+        if (hashes[j - 1] == self_hash) {   // hashes[j] reported how well it heard us
+          auto link = findLink(hashes[j], true);
+          link->fwd_snr = (int8_t) pkt->path[j];
+          link->fwd_power = link->tx_power;   // zero if we don't know
+          link->fwd_time = now;
+        }
+      }
+    }
+  }
+
+  /**
+   * \brief  chooses TX power for the packet about to be sent.
+   * \param  margin_db  link margin to keep above the SNR threshold. Zero disables power control
+   * \returns  the power (dBm) to set radio to, or zero if radio is already at the right power
+  */
+  uint8_t getPowerFor(const mesh::Packet* pkt, uint8_t max_dbm, uint8_t sf, uint8_t margin_db, uint32_t now) {
+    uint8_t power = max_dbm;
+    uint8_t hash;
+    TPCLink* link;
+    if (margin_db > 0 && getNextHop(pkt, hash) && (link = findLink(hash, false)) != NULL) {
+      float est_snr;    // what neighbour will hear us at, at max power
+      bool known = true;
+      if (link->fwd_power > 0 && now - link->fwd_time < TPC_MAX_AGE_SECS) {
+        est_snr = link->fwd_snr / 4.0f + (max_dbm - link->fwd_power);
+      } else if (link->num_rx >= TPC_MIN_RX_SAMPLES && now - link->rx_time < TPC_MAX_AGE_SECS) {
+        est_snr = link->rx_snr / 4.0f;   // assume link is symmetric, and they use same power as us
+      } else {
+        known = false;
+      }
+      if (known) {
+        int reduce = (int) (est_snr - getSNRThreshold(sf) - margin_db);
+        if (reduce > TPC_MAX_REDUCTION_DB) reduce = TPC_MAX_REDUCTION_DB;
+        if (reduce > max_dbm - 1) reduce = max_dbm - 1;
+        if (reduce > 0) power = max_dbm - reduce;
+      }
+      link->tx_power = power;
+    }
+
+    if (power == _cur_power) return 0;  // no change needed
+    _cur_power = power;
+    return power;
+  }
+};
@@ -26,7 +26,7 @@ public:
 
   float packetScore(float snr, int packet_len) override { return 0; }
   uint32_t intID();
-  void setTxPower(uint8_t dbm);
+  void setTxPower(uint8_t dbm) override;
 };
 
 #if ESPNOW_DEBUG_LOGGING && ARDUINO
@@ -9,13 +9,29 @@
 
 #define ADVERT_RESTART_DELAY  1000   // millis
 
+#define BLE_WRITE_MIN_INTERVAL   60   // millis, used until connection interval is known
+
+#ifndef BLE_PKTS_PER_CONN_EVENT
+  #define BLE_PKTS_PER_CONN_EVENT   2   // conservative, most centrals allow more
+#endif
+
+// preferred connection interval, in units of 1.25ms (centrals may choose otherwise)
+#define BLE_PREF_CONN_INTERVAL_MIN   12   // 15ms
+#define BLE_PREF_CONN_INTERVAL_MAX   24   // 30ms
+#define BLE_PREF_SUPERVISION_TIMEOUT 400  // 4 secs (units of 10ms)
+
+static SerialBLEInterface* instance;
+
 void SerialBLEInterface::begin(const char* device_name, uint32_t pin_code) {
   _pin_code = pin_code;
+  instance = this;
 
   // Create the BLE Device
   BLEDevice::init(device_name);
   BLEDevice::setSecurityCallbacks(this);
-  BLEDevice::setMTU(MAX_FRAME_SIZE);
+  BLEDevice::setMTU(MAX_FRAME_SIZE + 3);   // so a whole frame fits in one notification
+  BLEDevice::setCustomGattsHandler(onGattsEvent);
+  BLEDevice::setCustomGapHandler(onGapEvent);
 
   BLESecurity  sec;
   sec.setStaticPIN(pin_code);
@@ -83,14 +99,36 @@ void SerialBLEInterface::onConnect(BLEServer* pServer) {
 
 void SerialBLEInterface::onConnect(BLEServer* pServer, esp_ble_gatts_cb_param_t *param) {
   BLE_DEBUG_PRINTLN("onConnect(), conn_id=%d, mtu=%d", param->connect.conn_id, pServer->getPeerMTU(param->connect.conn_id));
+
+  _conn_interval = param->connect.conn_params.interval;
+  _congested = false;
+
+  // ask for a shorter connection interval, for faster syncs
+  pServer->updateConnParams(param->connect.remote_bda, BLE_PREF_CONN_INTERVAL_MIN, BLE_PREF_CONN_INTERVAL_MAX, 0,
+                            BLE_PREF_SUPERVISION_TIMEOUT);
 }
 
 void SerialBLEInterface::onMtuChanged(BLEServer* pServer, esp_ble_gatts_cb_param_t* param) {
   BLE_DEBUG_PRINTLN("onMtuChanged(), mtu=%d", pServer->getPeerMTU(param->mtu.conn_id));
 
+  _mtu = param->mtu.mtu;
   deviceConnected = true;
 }
 
+void SerialBLEInterface::onGattsEvent(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t* param) {
+  if (instance && event == ESP_GATTS_CONGEST_EVT) {
+    BLE_DEBUG_PRINTLN("onGattsEvent(), congested=%d", (int) param->congest.congested);
+    instance->_congested = param->congest.congested;
+  }
+}
+
+void SerialBLEInterface::onGapEvent(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t* param) {
+  if (instance && event == ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT && param->update_conn_params.status == ESP_BT_STATUS_SUCCESS) {
+    BLE_DEBUG_PRINTLN("onGapEvent(), conn_int=%d", (uint32_t) param->update_conn_params.conn_int);
+    instance->_conn_interval = param->update_conn_params.conn_int;
+  }
+}
+
 void SerialBLEInterface::onDisconnect(BLEServer* pServer) {
   BLE_DEBUG_PRINTLN("onDisconnect()");
   if (_isEnabled) {
@@ -108,12 +146,8 @@ void SerialBLEInterface::onWrite(BLECharacteristic* pCharacteristic, esp_ble_gat
 
   if (len > MAX_FRAME_SIZE) {
     BLE_DEBUG_PRINTLN("ERROR: onWrite(), frame too big, len=%d", len);
-  } else if (recv_queue_len >= FRAME_QUEUE_SIZE) {
+  } else if (!recv_queue.push(rxValue, len)) {
     BLE_DEBUG_PRINTLN("ERROR: onWrite(), recv_queue is full!");
-  } else {
-    recv_queue[recv_queue_len].len = len;
-    memcpy(recv_queue[recv_queue_len].buf, rxValue, len);
-    recv_queue_len++;
   }
 }
 
@@ -146,6 +180,7 @@ void SerialBLEInterface::disable() {
   pService->stop();
   oldDeviceConnected = deviceConnected = false;
   adv_restart_time = 0;
+  _mtu = _conn_interval = 0;
 }
 
 size_t SerialBLEInterface::writeFrame(const uint8_t src[], size_t len) {
@@ -155,52 +190,45 @@ size_t SerialBLEInterface::writeFrame(const uint8_t src[], size_t len) {
   }
 
   if (deviceConnected && len > 0) {
-    if (send_queue_len >= FRAME_QUEUE_SIZE) {
+    if (!send_queue.push(src, len)) {
       BLE_DEBUG_PRINTLN("writeFrame(), send_queue is full!");
       return 0;
     }
-
-    send_queue[send_queue_len].len = len;  // add to send queue
-    memcpy(send_queue[send_queue_len].buf, src, len);
-    send_queue_len++;
-
     return len;
   }
   return 0;
 }
 
-#define  BLE_WRITE_MIN_INTERVAL   60
+unsigned long SerialBLEInterface::getWriteInterval(size_t len) const {
+  if (_conn_interval == 0) return BLE_WRITE_MIN_INTERVAL;   // connection params not known yet
+
+  int payload = _mtu > 3 ? _mtu - 3 : 20;    // 20 = default ATT_MTU (23) - 3
+  int pkts = (len + payload - 1) / payload;
+  return (_conn_interval * 5 * pkts) / (4 * BLE_PKTS_PER_CONN_EVENT);   // conn interval is in 1.25ms units
+}
 
 bool SerialBLEInterface::isWriteBusy() const {
-  return millis() < _last_write + BLE_WRITE_MIN_INTERVAL;   // still too soon to start another write?
+  // let callers keep the queue topped up, but leave room for async 'push' frames
+  return _congested || send_queue.count() >= FRAME_QUEUE_SIZE / 2;
 }
 
 size_t SerialBLEInterface::checkRecvFrame(uint8_t dest[]) {
-  if (send_queue_len > 0   // first, check send queue
-    && millis() >= _last_write + BLE_WRITE_MIN_INTERVAL    // space the writes apart
+  if (!send_queue.isEmpty()   // first, check send queue
+    && !_congested            // stack has asked us to back off
+    && millis() - _last_write >= getWriteInterval(send_queue.peekLen())    // space the writes apart
   ) {
     _last_write = millis();
-    pTxCharacteristic->setValue(send_queue[0].buf, send_queue[0].len);
+    pTxCharacteristic->setValue((uint8_t *) send_queue.peekBuf(), send_queue.peekLen());
     pTxCharacteristic->notify();
 
-    BLE_DEBUG_PRINTLN("writeBytes: sz=%d, hdr=%d", (uint32_t)send_queue[0].len, (uint32_t) send_queue[0].buf[0]);
+    BLE_DEBUG_PRINTLN("writeBytes: sz=%d, hdr=%d", (uint32_t)send_queue.peekLen(), (uint32_t) send_queue.peekBuf()[0]);
 
-    send_queue_len--;
-    for (int i = 0; i < send_queue_len; i++) {   // delete top item from queue
-      send_queue[i] = send_queue[i + 1];
-    }
+    send_queue.pop();
   }
 
-  if (recv_queue_len > 0) {   // check recv queue
-    size_t len = recv_queue[0].len;   // take from top of queue
-    memcpy(dest, recv_queue[0].buf, len);
-
+  size_t len = recv_queue.pop(dest);   // check recv queue
+  if (len > 0) {
     BLE_DEBUG_PRINTLN("readBytes: sz=%d, hdr=%d", len, (uint32_t) dest[0]);
-
-    recv_queue_len--;
-    for (int i = 0; i < recv_queue_len; i++) {   // delete top item from queue
-      recv_queue[i] = recv_queue[i + 1];
-    }
     return len;
   }
 
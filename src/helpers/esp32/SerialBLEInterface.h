@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../BaseSerialInterface.h"
+#include "../FrameQueue.h"
 #include <BLEDevice.h>
 #include <BLEServer.h>
 #include <BLEUtils.h>
@@ -16,19 +17,18 @@ class SerialBLEInterface : public BaseSerialInterface, BLESecurityCallbacks, BLE
   uint32_t _pin_code;
   unsigned long _last_write;
   unsigned long adv_restart_time;
+  uint16_t _mtu;                 // negotiated ATT MTU, 0 = not known yet
+  uint16_t _conn_interval;       // in units of 1.25ms, 0 = not known yet
+  volatile bool _congested;      // set by ESP_GATTS_CONGEST_EVT
 
-  struct Frame {
-    uint8_t len;
-    uint8_t buf[MAX_FRAME_SIZE];
-  };
+  FrameQueue recv_queue;
+  FrameQueue send_queue;
 
-  #define FRAME_QUEUE_SIZE  4
-  int recv_queue_len;
-  Frame recv_queue[FRAME_QUEUE_SIZE];
-  int send_queue_len;
-  Frame send_queue[FRAME_QUEUE_SIZE];
+  void clearBuffers() { recv_queue.clear(); send_queue.clear(); _congested = false; }
+  unsigned long getWriteInterval(size_t len) const;
 
-  void clearBuffers() { recv_queue_len = 0; send_queue_len = 0; }
+  static void onGattsEvent(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t* param);
+  static void onGapEvent(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t* param);
 
 protected:
   // BLESecurityCallbacks methods
@@ -56,7 +56,8 @@ public:
     adv_restart_time = 0;
     _isEnabled = false;
     _last_write = 0;
-    send_queue_len = recv_queue_len = 0;
+    _mtu = _conn_interval = 0;
+    _congested = false;
   }
 
   void begin(const char* device_name, uint32_t pin_code);
@@ -1,9 +1,34 @@
 #include "SerialWifiInterface.h"
 #include <WiFi.h>
 
+#define RECV_STATE_IDLE        0
+#define RECV_STATE_HDR_FOUND   1
+#define RECV_STATE_LEN1_FOUND  2
+#define RECV_STATE_LEN2_FOUND  3
+
+#define FRAME_HDR_SIZE         3
+
+// frames with codes at or above this are unsolicited 'push' frames, so go to ALL clients
+#define PUSH_CODE_MIN          0x80
+
+#define CLIENT_GONE            -2   // (_cmd_client) responses are dropped, as requesting client has disconnected
+
 void SerialWifiInterface::begin(int port) {
   // wifi setup is handled outside of this class, only starts the server
   server.begin(port);
+  server.setNoDelay(true);
+}
+
+void SerialWifiInterface::resetSlot(ClientSlot& slot) {
+  slot.state = RECV_STATE_IDLE;
+  slot.chunk_pos = slot.chunk_len = 0;
+  slot.tx_head = slot.tx_len = 0;
+}
+
+void SerialWifiInterface::clearBuffers() {
+  for (int i = 0; i < WIFI_MAX_CLIENTS; i++) {
+    resetSlot(slots[i]);
+  }
 }
 
 // ---------- public methods
@@ -18,6 +43,23 @@ void SerialWifiInterface::disable() {
   _isEnabled = false;
 }
 
+bool SerialWifiInterface::queueTx(ClientSlot& slot, const uint8_t src[], size_t len) {
+  if (slot.tx_len + FRAME_HDR_SIZE + len > WIFI_TX_BUFFER_SIZE) return false;  // no room
+
+  uint8_t hdr[FRAME_HDR_SIZE]; // use same header as serial interface so client can delimit frames
+  hdr[0] = '>';
+  hdr[1] = (len & 0xFF);  // LSB
+  hdr[2] = (len >> 8);    // MSB
+
+  uint16_t pos = (slot.tx_head + slot.tx_len) % WIFI_TX_BUFFER_SIZE;
+  for (int i = 0; i < FRAME_HDR_SIZE + len; i++) {
+    slot.tx_buf[pos] = i < FRAME_HDR_SIZE ? hdr[i] : src[i - FRAME_HDR_SIZE];
+    if (++pos >= WIFI_TX_BUFFER_SIZE) pos = 0;
+  }
+  slot.tx_len += FRAME_HDR_SIZE + len;
+  return true;
+}
+
 size_t SerialWifiInterface::writeFrame(const uint8_t src[], size_t len) {
   if (len > MAX_FRAME_SIZE) {
     WIFI_DEBUG_PRINTLN("writeFrame(), frame too big, len=%d\n", len);
@@ -25,69 +67,166 @@ size_t SerialWifiInterface::writeFrame(const uint8_t src[], size_t len) {
   }
 
   if (deviceConnected && len > 0) {
-    if (send_queue_len >= FRAME_QUEUE_SIZE) {
-      WIFI_DEBUG_PRINTLN("writeFrame(), send_queue is full!");
-      return 0;
-    }
+    // responses just go to the client that sent the command, pushes go to everyone
+    bool to_all = src[0] >= PUSH_CODE_MIN || _cmd_client == -1;
 
-    send_queue[send_queue_len].len = len;  // add to send queue
-    memcpy(send_queue[send_queue_len].buf, src, len);
-    send_queue_len++;
+    bool queued = false;
+    for (int i = 0; i < WIFI_MAX_CLIENTS; i++) {
+      if (!slots[i].active || !(to_all || i == _cmd_client)) continue;
 
-    return len;
+      if (queueTx(slots[i], src, len)) {
+        queued = true;
+      } else {
+        WIFI_DEBUG_PRINTLN("writeFrame(), send buffer is full! client=%d", i);
+      }
+    }
+    return queued ? len : 0;
   }
   return 0;
 }
 
 bool SerialWifiInterface::isWriteBusy() const {
-  return false;
+  // busy if reply client doesn't have room for a couple more frames. (a slow client shouldn't hold up the others)
+  if (_cmd_client < 0) return false;
+  auto slot = &slots[_cmd_client];
+  return slot->active && slot->tx_len + 2*(FRAME_HDR_SIZE + MAX_FRAME_SIZE) > WIFI_TX_BUFFER_SIZE;
 }
 
-size_t SerialWifiInterface::checkRecvFrame(uint8_t dest[]) {
-  if (!client) client = server.available();
+int SerialWifiInterface::getReplyTarget() const {
+  return _cmd_client >= 0 ? slots[_cmd_client].conn_id : 0;
+}
 
-  if (client.connected()) {
-    if (!deviceConnected) {
-      WIFI_DEBUG_PRINTLN("Got connection");
-      deviceConnected = true;
-    }
-  } else {
-    if (deviceConnected) {
-      deviceConnected = false;
-      WIFI_DEBUG_PRINTLN("Disconnected");
+void SerialWifiInterface::setReplyTarget(int target) {
+  for (int i = 0; i < WIFI_MAX_CLIENTS; i++) {
+    if (slots[i].active && slots[i].conn_id == target) {
+      _cmd_client = i;
+      return;
     }
   }
+  _cmd_client = CLIENT_GONE;
+}
 
-  if (deviceConnected) {
-    if (send_queue_len > 0) {   // first, check send queue
-      
-      _last_write = millis();
-      int len = send_queue[0].len;
-
-      uint8_t pkt[3+len]; // use same header as serial interface so client can delimit frames
-      pkt[0] = '>';
-      pkt[1] = (len & 0xFF);  // LSB
-      pkt[2] = (len >> 8);    // MSB
-      memcpy(&pkt[3], send_queue[0].buf, send_queue[0].len);
-      client.write(pkt, 3 + len);
-      send_queue_len--;
-      for (int i = 0; i < send_queue_len; i++) {   // delete top item from queue
-        send_queue[i] = send_queue[i + 1];
-      }
+void SerialWifiInterface::flushTx(ClientSlot& slot) {
+  while (slot.tx_len > 0) {   // at most two writes, when data wraps around end of ring
+    size_t n = slot.tx_len;
+    if (slot.tx_head + n > WIFI_TX_BUFFER_SIZE) n = WIFI_TX_BUFFER_SIZE - slot.tx_head;
+
+    size_t written = slot.client.write(&slot.tx_buf[slot.tx_head], n);
+    if (written == 0) break;   // socket buffer full, or error. Try again next time
+
+    _last_write = millis();
+    slot.tx_head = (slot.tx_head + written) % WIFI_TX_BUFFER_SIZE;
+    slot.tx_len -= written;
+    if (written < n) break;
+  }
+}
+
+void SerialWifiInterface::acceptClients() {
+  while (server.hasClient()) {
+    WiFiClient c = server.available();
+    int i = 0;
+    while (i < WIFI_MAX_CLIENTS && slots[i].active) i++;
+
+    if (i < WIFI_MAX_CLIENTS) {
+      WIFI_DEBUG_PRINTLN("Got connection, client=%d", i);
+      resetSlot(slots[i]);
+      slots[i].client = c;
+      slots[i].client.setNoDelay(true);
+      slots[i].active = true;
+      slots[i].conn_id = _next_conn_id++;
+      if (_next_conn_id == 0) _next_conn_id = 1;   // zero means no target
     } else {
-      int len = client.available();
-      if (len > 0) {
-        uint8_t buf[MAX_FRAME_SIZE + 4];
-        client.readBytes(buf, len);
-        memcpy(dest, buf+3, len-3); // remove header (don't even check ... problems are on the other dir)
-        return len-3;
+      WIFI_DEBUG_PRINTLN("Too many clients, rejecting connection");
+      c.stop();
+    }
+  }
+}
+
+size_t SerialWifiInterface::parseRx(ClientSlot& slot, uint8_t dest[]) {
+  while (true) {
+    if (slot.chunk_pos >= slot.chunk_len) {   // need more bytes from socket?
+      int avail = slot.client.available();
+      if (avail <= 0) return 0;
+
+      int n = slot.client.read(slot.chunk, avail < WIFI_RX_CHUNK_SIZE ? avail : WIFI_RX_CHUNK_SIZE);
+      if (n <= 0) return 0;
+      slot.chunk_pos = 0;
+      slot.chunk_len = n;
+    }
+
+    while (slot.chunk_pos < slot.chunk_len) {
+      uint8_t c = slot.chunk[slot.chunk_pos++];
+
+      switch (slot.state) {
+        case RECV_STATE_IDLE:
+          if (c == '<') {
+            slot.state = RECV_STATE_HDR_FOUND;
+          }
+          break;
+        case RECV_STATE_HDR_FOUND:
+          slot.frame_len = c;   // LSB
+          slot.state = RECV_STATE_LEN1_FOUND;
+          break;
+        case RECV_STATE_LEN1_FOUND:
+          slot.frame_len |= ((uint16_t)c) << 8;   // MSB
+          slot.rx_len = 0;
+          slot.state = slot.frame_len > 0 ? RECV_STATE_LEN2_FOUND : RECV_STATE_IDLE;
+          break;
+        default:
+          if (slot.rx_len < MAX_FRAME_SIZE) {
+            slot.rx_buf[slot.rx_len] = c;   // rest of frame will be discarded if > MAX
+          }
+          slot.rx_len++;
+          if (slot.rx_len >= slot.frame_len) {  // received a complete frame?
+            if (slot.frame_len > MAX_FRAME_SIZE) slot.frame_len = MAX_FRAME_SIZE;    // truncate
+            memcpy(dest, slot.rx_buf, slot.frame_len);
+            slot.state = RECV_STATE_IDLE;  // reset state, for next frame
+            return slot.frame_len;   // any remaining bytes stay in chunk[], for next call
+          }
       }
     }
   }
+}
+
+size_t SerialWifiInterface::checkRecvFrame(uint8_t dest[]) {
+  acceptClients();
+
+  bool any = false;
+  for (int i = 0; i < WIFI_MAX_CLIENTS; i++) {
+    auto slot = &slots[i];
+    if (!slot->active) continue;
+
+    if (!slot->client.connected() && slot->client.available() == 0 && slot->chunk_pos >= slot->chunk_len) {
+      WIFI_DEBUG_PRINTLN("Disconnected, client=%d", i);
+      slot->client.stop();
+      slot->active = false;
+      if (_cmd_client == i) _cmd_client = CLIENT_GONE;
+      continue;
+    }
+    any = true;
+    flushTx(*slot);   // write ALL pending frames
+  }
 
+  if (any != deviceConnected) {
+    deviceConnected = any;
+    WIFI_DEBUG_PRINTLN(any ? "Got connection" : "Disconnected");
+  }
+
+  // round-robin over clients, so one busy client can't starve others
+  for (int k = 0; k < WIFI_MAX_CLIENTS; k++) {
+    int i = (_next_recv + k) % WIFI_MAX_CLIENTS;
+    if (!slots[i].active) continue;
+
+    size_t len = parseRx(slots[i], dest);
+    if (len > 0) {
+      _cmd_client = i;   // responses to this command go back to this client
+      _next_recv = (i + 1) % WIFI_MAX_CLIENTS;
+      return len;
+    }
+  }
   return 0;
 }
 
 bool SerialWifiInterface::isConnected() const {
-  return deviceConnected;  //pServer != NULL && pServer->getConnectedCount() > 0;
-}
\ No newline at end of file
+  return deviceConnected;
+}
@@ -3,6 +3,16 @@
 #include "../BaseSerialInterface.h"
 #include <WiFi.h>
 
+#ifndef WIFI_MAX_CLIENTS
+  #define WIFI_MAX_CLIENTS      3
+#endif
+
+#ifndef WIFI_TX_BUFFER_SIZE
+  #define WIFI_TX_BUFFER_SIZE   2048   // per client, encoded frames waiting to be written
+#endif
+
+#define WIFI_RX_CHUNK_SIZE      256
+
 class SerialWifiInterface : public BaseSerialInterface {
   bool deviceConnected;
   bool _isEnabled;
@@ -10,29 +20,48 @@ class SerialWifiInterface : public BaseSerialInterface {
   unsigned long adv_restart_time;
 
   WiFiServer server;
-  WiFiClient client;
 
-  struct Frame {
-    uint8_t len;
-    uint8_t buf[MAX_FRAME_SIZE];
-  };
+  struct ClientSlot {
+    WiFiClient client;
+    bool active;
+    uint16_t conn_id;   // unique per connection, so a reply target isn't mistaken for a later client in same slot
 
-  #define FRAME_QUEUE_SIZE  4
-  int recv_queue_len;
-  Frame recv_queue[FRAME_QUEUE_SIZE];
-  int send_queue_len;
-  Frame send_queue[FRAME_QUEUE_SIZE];
+    // inbound, same framing as ArduinoSerialInterface ('<', len LSB, len MSB, payload)
+    uint8_t state;
+    uint16_t frame_len;
+    uint16_t rx_len;
+    uint8_t rx_buf[MAX_FRAME_SIZE];
+    uint8_t chunk[WIFI_RX_CHUNK_SIZE];   // raw bytes read from socket, not yet parsed
+    uint16_t chunk_pos, chunk_len;
+
+    // outbound, ring of encoded frames ('>', len LSB, len MSB, payload)
+    uint8_t tx_buf[WIFI_TX_BUFFER_SIZE];
+    uint16_t tx_head, tx_len;
+  };
+  ClientSlot slots[WIFI_MAX_CLIENTS];
+  int _cmd_client;    // slot of client which gets the responses (sent most recent command, or setReplyTarget()), -1 if none
+  uint16_t _next_conn_id;
+  int _next_recv;     // for round-robin over clients
 
-  void clearBuffers() { recv_queue_len = 0; send_queue_len = 0; }
+  void clearBuffers();
+  void resetSlot(ClientSlot& slot);
+  void acceptClients();
+  bool queueTx(ClientSlot& slot, const uint8_t src[], size_t len);
+  void flushTx(ClientSlot& slot);
+  size_t parseRx(ClientSlot& slot, uint8_t dest[]);
 
 protected:
 
 public:
-  SerialWifiInterface() : server(WiFiServer()), client(WiFiClient()) {
+  SerialWifiInterface() : server(WiFiServer()) {
     deviceConnected = false;
     _isEnabled = false;
     _last_write = 0;
-    send_queue_len = recv_queue_len = 0;
+    _cmd_client = -1;
+    _next_recv = 0;
+    _next_conn_id = 1;
+    for (int i = 0; i < WIFI_MAX_CLIENTS; i++) slots[i].active = false;
+    clearBuffers();
   }
 
   void begin(int port);
@@ -44,6 +73,8 @@ public:
 
   bool isConnected() const override;
   bool isWriteBusy() const override;
+  int getReplyTarget() const override;
+  void setReplyTarget(int target) override;
 
   size_t writeFrame(const uint8_t src[], size_t len) override;
   size_t checkRecvFrame(uint8_t dest[]) override;
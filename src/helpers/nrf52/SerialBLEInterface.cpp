@@ -2,10 +2,18 @@
 
 static SerialBLEInterface* instance;
 
+#define BLE_WRITE_MIN_INTERVAL   60   // millis, used until connection interval is known
+#define BLE_WRITE_RETRY_DELAY    10   // millis, after a failed notify
+
+#ifndef BLE_PKTS_PER_CONN_EVENT
+  #define BLE_PKTS_PER_CONN_EVENT   2   // conservative, BANDWIDTH_MAX event length allows more
+#endif
+
 void SerialBLEInterface::onConnect(uint16_t connection_handle) {
   BLE_DEBUG_PRINTLN("SerialBLEInterface: connected");
   if(instance){
     instance->_isDeviceConnected = true;
+    instance->_conn_handle = connection_handle;
     // no need to stop advertising on connect, as the ble stack does this automatically
   }
 }
@@ -14,6 +22,7 @@ void SerialBLEInterface::onDisconnect(uint16_t connection_handle, uint8_t reason
   BLE_DEBUG_PRINTLN("SerialBLEInterface: disconnected reason=%d", reason);
   if(instance){
     instance->_isDeviceConnected = false;
+    instance->_conn_handle = BLE_CONN_HANDLE_INVALID;
     instance->startAdv();
   }
 }
@@ -34,6 +43,7 @@ void SerialBLEInterface::begin(const char* device_name, uint32_t pin_code) {
   Bluefruit.Security.setMITM(true);
   Bluefruit.Security.setPIN(charpin);
 
+  Bluefruit.Periph.setConnIntervalMS(15, 30);   // preferred, for faster syncs (central may choose otherwise)
   Bluefruit.Periph.setConnectCallback(onConnect);
   Bluefruit.Periph.setDisconnectCallback(onDisconnect);
 
@@ -125,46 +135,69 @@ size_t SerialBLEInterface::writeFrame(const uint8_t src[], size_t len) {
   }
 
   if (_isDeviceConnected && len > 0) {
-    if (send_queue_len >= FRAME_QUEUE_SIZE) {
+    if (!send_queue.push(src, len)) {
       BLE_DEBUG_PRINTLN("writeFrame(), send_queue is full!");
       return 0;
     }
-
-    send_queue[send_queue_len].len = len;  // add to send queue
-    memcpy(send_queue[send_queue_len].buf, src, len);
-    send_queue_len++;
-
     return len;
   }
   return 0;
 }
 
-#define  BLE_WRITE_MIN_INTERVAL   60
+unsigned long SerialBLEInterface::getWriteInterval(size_t len) const {
+  BLEConnection* conn = Bluefruit.Connection(_conn_handle);
+  if (conn == NULL || conn->getConnectionInterval() == 0) return BLE_WRITE_MIN_INTERVAL;
+
+  int mtu = conn->getMtu();
+  int payload = mtu > 3 ? mtu - 3 : 20;    // 20 = default ATT_MTU (23) - 3
+  int pkts = (len + payload - 1) / payload;
+  return (conn->getConnectionInterval() * 5 * pkts) / (4 * BLE_PKTS_PER_CONN_EVENT);   // interval is in 1.25ms units
+}
 
 bool SerialBLEInterface::isWriteBusy() const {
-  return millis() < _last_write + BLE_WRITE_MIN_INTERVAL;   // still too soon to start another write?
+  // let callers keep the queue topped up, but leave room for async 'push' frames
+  return _retry_write != 0 || send_queue.count() >= FRAME_QUEUE_SIZE / 2;
 }
 
 size_t SerialBLEInterface::checkRecvFrame(uint8_t dest[]) {
-  if (send_queue_len > 0   // first, check send queue
-    && millis() >= _last_write + BLE_WRITE_MIN_INTERVAL    // space the writes apart
+  if (!_isDeviceConnected && !send_queue.isEmpty()) {
+    clearBuffers();   // discard frames left over from last connection
+  }
+
+  if (!send_queue.isEmpty()   // first, check send queue
+    && millis() - _last_write >= (_retry_write ? _retry_write : getWriteInterval(send_queue.peekLen()))
   ) {
     _last_write = millis();
-    bleuart.write(send_queue[0].buf, send_queue[0].len);
-    BLE_DEBUG_PRINTLN("writeBytes: sz=%d, hdr=%d", (uint32_t)send_queue[0].len, (uint32_t) send_queue[0].buf[0]);
-
-    send_queue_len--;
-    for (int i = 0; i < send_queue_len; i++) {   // delete top item from queue
-      send_queue[i] = send_queue[i + 1];
-    }
-  } else {
-    int len = bleuart.available();
-    if (len > 0) {
-      bleuart.readBytes(dest, len);
-      BLE_DEBUG_PRINTLN("readBytes: sz=%d, hdr=%d", len, (uint32_t) dest[0]);
-      return len;
+    size_t len = send_queue.peekLen() - _write_ofs;
+    size_t n = bleuart.write(send_queue.peekBuf() + _write_ofs, len);
+    BLE_DEBUG_PRINTLN("writeBytes: sz=%d, hdr=%d, ofs=%d, sent=%d", (uint32_t)len, (uint32_t) send_queue.peekBuf()[0], (uint32_t)_write_ofs, (uint32_t)n);
+
+    if (n == 0 && _isDeviceConnected) {
+      // no notification buffers available, keep frame at head of queue and back off
+      _retry_write = _retry_write ? _retry_write * 2 : BLE_WRITE_RETRY_DELAY;
+      if (_retry_write > BLE_WRITE_MIN_INTERVAL * 4) {
+        BLE_DEBUG_PRINTLN("writeFrame(), giving up on frame");
+        send_queue.pop();
+        _retry_write = 0;
+        _write_ofs = 0;
+      }
+    } else if (n < len && _isDeviceConnected) {
+      // ran out of buffers part way through frame (> MTU), resume from there. Don't re-send what has gone
+      _write_ofs += n;
+      _retry_write = BLE_WRITE_RETRY_DELAY;
+    } else {
+      send_queue.pop();
+      _retry_write = 0;
+      _write_ofs = 0;
     }
   }
+
+  int len = bleuart.available();
+  if (len > 0) {
+    bleuart.readBytes(dest, len);
+    BLE_DEBUG_PRINTLN("readBytes: sz=%d, hdr=%d", len, (uint32_t) dest[0]);
+    return len;
+  }
   return 0;
 }
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../BaseSerialInterface.h"
+#include "../FrameQueue.h"
 #include <bluefruit.h>
 
 class SerialBLEInterface : public BaseSerialInterface {
@@ -8,17 +9,14 @@ class SerialBLEInterface : public BaseSerialInterface {
   bool _isEnabled;
   bool _isDeviceConnected;
   unsigned long _last_write;
+  unsigned long _retry_write;    // non-zero when last write failed (ie. no HVN tx buffers)
+  uint16_t _write_ofs;           // bytes of frame at head of send_queue already sent (when frame needs several notifies)
+  uint16_t _conn_handle;
 
-  struct Frame {
-    uint8_t len;
-    uint8_t buf[MAX_FRAME_SIZE];
-  };
+  FrameQueue send_queue;
 
-  #define FRAME_QUEUE_SIZE  4
-  int send_queue_len;
-  Frame send_queue[FRAME_QUEUE_SIZE];
-
-  void clearBuffers() { send_queue_len = 0; }
+  void clearBuffers() { send_queue.clear(); _retry_write = 0; _write_ofs = 0; }
+  unsigned long getWriteInterval(size_t len) const;
   static void onConnect(uint16_t connection_handle);
   static void onDisconnect(uint16_t connection_handle, uint8_t reason);
 
@@ -27,7 +25,9 @@ public:
     _isEnabled = false;
     _isDeviceConnected = false;
     _last_write = 0;
-    send_queue_len = 0;
+    _retry_write = 0;
+    _write_ofs = 0;
+    _conn_handle = BLE_CONN_HANDLE_INVALID;
   }
 
   void startAdv();
@@ -13,6 +13,10 @@ public:
   float getCurrentRSSI() override {
     return ((CustomSTM32WLx *)_radio)->getRSSI(false);
   }
+  int16_t startReceiveDutyCycle() override {
+    // sleep/listen periods are derived from preamble length, so that a listen window always falls within a preamble
+    return ((CustomSTM32WLx *)_radio)->startReceiveDutyCycleAuto(0, RX_DUTY_CYCLE_MIN_SYMBOLS);
+  }
   float getLastRSSI() const override { return ((CustomSTM32WLx *)_radio)->getRSSI(); }
   float getLastSNR() const override { return ((CustomSTM32WLx *)_radio)->getSNR(); }
 
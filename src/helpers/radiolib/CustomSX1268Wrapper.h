@@ -12,6 +12,10 @@ public:
   float getCurrentRSSI() override {
     return ((CustomSX1268 *)_radio)->getRSSI(false);
   }
+  int16_t startReceiveDutyCycle() override {
+    // sleep/listen periods are derived from preamble length, so that a listen window always falls within a preamble
+    return ((CustomSX1268 *)_radio)->startReceiveDutyCycleAuto(0, RX_DUTY_CYCLE_MIN_SYMBOLS);
+  }
   float getLastRSSI() const override { return ((CustomSX1268 *)_radio)->getRSSI(); }
   float getLastSNR() const override { return ((CustomSX1268 *)_radio)->getSNR(); }
 
@@ -77,14 +77,18 @@ class CustomSX1276 : public SX1276 {
       int16_t state = startChannelScan();
       RADIOLIB_ASSERT(state);
 
-      // wait for channel activity detected or timeout
-      unsigned long timeout = millis() + 16;
+      // wait for channel activity detected or timeout. CAD takes about 2 symbols, so allow 4
+      float bw = this->bandwidth > 0 ? this->bandwidth : 125.0f;
+      unsigned long timeout = millis() + 2 + (unsigned long) (4.0f * (1 << this->spreadingFactor) / bw);
       while(!this->mod->hal->digitalRead(this->mod->getIrq()) && millis() < timeout) {
         this->mod->hal->yield();
         if(this->mod->hal->digitalRead(this->mod->getGpio())) {
           return(RADIOLIB_PREAMBLE_DETECTED);
         }
       }
-      return 0; // timed out
+      if (this->mod->hal->digitalRead(this->mod->getGpio())) {   // detected in same instant as CAD done
+        return(RADIOLIB_PREAMBLE_DETECTED);
+      }
+      return 0; // timed out, or channel free
     }
 };
@@ -8,10 +8,12 @@
 #define STATE_TX_DONE    4
 #define STATE_INT_READY 16
 
-#define NUM_NOISE_FLOOR_SAMPLES  64
-#define SAMPLING_THRESHOLD  14
+#ifndef NOISE_FLOOR_SAMPLE_MILLIS
+  #define NOISE_FLOOR_SAMPLE_MILLIS   250    // with NOISE_FLOOR_WINDOW of 128, floor follows last ~30 secs
+#endif
 
 static volatile uint8_t state = STATE_IDLE;
+static volatile uint32_t irq_micros;   // when last interrupt (RxDone/TxDone) happened
 
 // this function is called when a complete packet
 // is transmitted by the module
@@ -21,6 +23,7 @@ static
 #endif
 void setFlag(void) {
   // we sent a packet, set the flag
+  irq_micros = micros();
   state |= STATE_INT_READY;
 }
 
@@ -34,10 +37,8 @@ void RadioLibWrapper::begin() {
 
   _noise_floor = 0;
   _threshold = 0;
-
-  // start average out some samples
-  _num_floor_samples = 0;
-  _floor_sample_sum = 0;
+  _floor_tracker.reset();
+  _next_floor_sample = millis();
 }
 
 void RadioLibWrapper::idle() {
@@ -46,11 +47,9 @@ void RadioLibWrapper::idle() {
 }
 
 void RadioLibWrapper::triggerNoiseFloorCalibrate(int threshold) {
+  // floor is tracked continuously now (see loop()), just need the latest threshold
   _threshold = threshold;
-  if (_num_floor_samples >= NUM_NOISE_FLOOR_SAMPLES) {  // ignore trigger if currently sampling
-    _num_floor_samples = 0;
-    _floor_sample_sum = 0;
-  }
+  _floor_tracker.setBurstThreshold(threshold > 0 ? threshold : NOISE_FLOOR_QUIET_SPREAD);
 }
 
 void RadioLibWrapper::resetAGC() {
@@ -63,27 +62,39 @@ void RadioLibWrapper::resetAGC() {
 }
 
 void RadioLibWrapper::loop() {
-  if (state == STATE_RX && _num_floor_samples < NUM_NOISE_FLOOR_SAMPLES) {
-    if (!isReceivingPacket()) {
-      int rssi = getCurrentRSSI();
-      if (rssi < _noise_floor + SAMPLING_THRESHOLD) {  // only consider samples below current floor + sampling THRESHOLD
-        _num_floor_samples++;
-        _floor_sample_sum += rssi;
+  if (_board->checkRadioWakeup() && state == STATE_RX) {
+    setFlag();   // interrupt was masked while board slept
+  }
+  if (state == STATE_RX && !_rx_duty_cycle && (long)(millis() - _next_floor_sample) >= 0 && !isReceivingPacket()) {
+    _next_floor_sample = millis() + NOISE_FLOOR_SAMPLE_MILLIS;
+    _floor_tracker.addSample(getCurrentRSSI());
+
+    if (_floor_tracker.isValid()) {
+      int16_t floor = _floor_tracker.getFloor();
+      if (floor < -120) {
+        floor = -120;    // clamp to lower bound of -120dBi
+      }
+      if (floor != _noise_floor) {
+        _noise_floor = floor;
+        MESH_DEBUG_PRINTLN("RadioLibWrapper: noise_floor = %d", (int)_noise_floor);
       }
     }
-  } else if (_num_floor_samples >= NUM_NOISE_FLOOR_SAMPLES && _floor_sample_sum != 0) {
-    _noise_floor = _floor_sample_sum / NUM_NOISE_FLOOR_SAMPLES;
-    if (_noise_floor < -120) {
-      _noise_floor = -120;    // clamp to lower bound of -120dBi
-    }
-    _floor_sample_sum = 0;
+  }
+}
 
-    MESH_DEBUG_PRINTLN("RadioLibWrapper: noise_floor = %d", (int)_noise_floor);
+void RadioLibWrapper::setRxDutyCycle(bool enable) {
+  if (enable != _rx_duty_cycle) {
+    _rx_duty_cycle = enable;
+    if (isInRecvMode()) idle();   // restart receive in new mode
   }
 }
 
+bool RadioLibWrapper::isSleepAllowed() const {
+  return state == STATE_RX;   // (not while waiting for TX to finish, or packet not read yet)
+}
+
 void RadioLibWrapper::startRecv() {
-  int err = _radio->startReceive();
+  int err = _rx_duty_cycle ? startReceiveDutyCycle() : _radio->startReceive();
   if (err == RADIOLIB_ERR_NONE) {
     state = STATE_RX;
   } else {
@@ -108,13 +119,14 @@ int RadioLibWrapper::recvRaw(uint8_t* bytes, int sz) {
       } else {
       //  Serial.print("  readData() -> "); Serial.println(len);
         n_recv++;
+        _rx_micros = irq_micros;
       }
     }
     state = STATE_IDLE;   // need another startReceive()
   }
 
   if (state != STATE_RX) {
-    int err = _radio->startReceive();
+    int err = _rx_duty_cycle ? startReceiveDutyCycle() : _radio->startReceive();
     if (err == RADIOLIB_ERR_NONE) {
       state = STATE_RX;
     } else {
@@ -125,13 +137,24 @@ int RadioLibWrapper::recvRaw(uint8_t* bytes, int sz) {
 }
 
 uint32_t RadioLibWrapper::getEstAirtimeFor(int len_bytes) {
-  return _radio->getTimeOnAir(len_bytes) / 1000;
+  // getTimeOnAir() is float math, and this is called several times for every packet. Results are cached per length
+  if (len_bytes < 0 || len_bytes > MAX_TRANS_UNIT) return _radio->getTimeOnAir(len_bytes) / 1000;
+
+  uint16_t t = _airtime_table[len_bytes];
+  if (t == 0) {
+    uint32_t ms = _radio->getTimeOnAir(len_bytes) / 1000;
+    if (ms == 0 || ms >= 0xFFFF) return ms;   // can't be cached (only with extreme params)
+    _airtime_table[len_bytes] = t = ms;
+  }
+  return t;
 }
 
 bool RadioLibWrapper::startSendRaw(const uint8_t* bytes, int len) {
   _board->onBeforeTransmit();
   int err = _radio->startTransmit((uint8_t *) bytes, len);
   if (err == RADIOLIB_ERR_NONE) {
+    _tx_start_micros = micros();   // (startTransmit() returns once radio is in TX)
+    _tx_air_micros = 0;
     state = STATE_TX_WAIT;
     return true;
   }
@@ -142,6 +165,7 @@ bool RadioLibWrapper::startSendRaw(const uint8_t* bytes, int len) {
 
 bool RadioLibWrapper::isSendComplete() {
   if (state & STATE_INT_READY) {
+    _tx_air_micros = irq_micros - _tx_start_micros;
     state = STATE_IDLE;
     n_sent++;
     return true;
@@ -156,9 +180,18 @@ void RadioLibWrapper::onSendFinished() {
 }
 
 bool RadioLibWrapper::isChannelActive() {
-  return _threshold == 0 
-          ? false    // interference check is disabled
-          : getCurrentRSSI() > _noise_floor + _threshold;
+  if (_threshold == 0) return false;   // listen-before-talk is disabled
+
+  if (!_rx_duty_cycle && getCurrentRSSI() > _noise_floor + _threshold) {
+    return true;
+  }
+  if (_use_cad && state == STATE_RX) {
+    // CAD can pick up preambles of transmissions well below the noise floor, which RSSI can't
+    bool detected = scanChannel();
+    state = STATE_IDLE;   // CAD-done may have raised the IRQ flag, and radio is in standby. Need another startReceive()
+    return detected;
+  }
+  return false;
 }
 
 float RadioLibWrapper::getLastRSSI() const {
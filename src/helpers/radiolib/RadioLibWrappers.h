@@ -2,6 +2,15 @@
 
 #include <Mesh.h>
 #include <RadioLib.h>
+#include <helpers/NoiseFloorTracker.h>
+
+#ifndef RX_DUTY_CYCLE_MIN_SYMBOLS
+  #define RX_DUTY_CYCLE_MIN_SYMBOLS   5    // preamble symbols needed in a listen window, for detection
+#endif
+
+#ifndef LBT_USE_CAD
+  #define LBT_USE_CAD   1    // when listen-before-talk is enabled (non-zero interference threshold), also run a hardware Channel Activity Detect
+#endif
 
 class RadioLibWrapper : public mesh::Radio {
 protected:
@@ -9,20 +18,43 @@ protected:
   mesh::MainBoard* _board;
   uint32_t n_recv, n_sent;
   int16_t _noise_floor, _threshold;
-  uint16_t _num_floor_samples;
-  int32_t _floor_sample_sum;
+  NoiseFloorTracker _floor_tracker;
+  unsigned long _next_floor_sample;
+  bool _use_cad;
+  bool _rx_duty_cycle;
+  uint32_t _rx_micros, _tx_start_micros, _tx_air_micros;
+  uint16_t _airtime_table[MAX_TRANS_UNIT+1];   // millis, by packet length. Zero if not calculated yet
 
   void idle();
   void startRecv();
   float packetScoreInt(float snr, int sf, int packet_len);
   virtual bool isReceivingPacket() =0;
 
+  /**
+   * \brief  runs a (blocking) Channel Activity Detect. Leaves radio out of Rx mode.
+   * \returns  true if a LoRa preamble was detected
+  */
+  virtual bool scanChannel() { return _radio->scanChannel() == RADIOLIB_LORA_DETECTED; }
+
+  /**
+   * \brief  starts receive, with radio sleeping between short listen windows. Default is continuous receive, for
+   *       radios which don't support it.
+  */
+  virtual int16_t startReceiveDutyCycle() { return _radio->startReceive(); }
+
 public:
-  RadioLibWrapper(PhysicalLayer& radio, mesh::MainBoard& board) : _radio(&radio), _board(&board) { n_recv = n_sent = 0; }
+  RadioLibWrapper(PhysicalLayer& radio, mesh::MainBoard& board) : _radio(&radio), _board(&board) {
+    n_recv = n_sent = 0; _use_cad = LBT_USE_CAD; _rx_duty_cycle = false;
+    _rx_micros = _tx_start_micros = _tx_air_micros = 0;
+    resetAirtimeTable();
+  }
 
   void begin() override;
   int recvRaw(uint8_t* bytes, int sz) override;
   uint32_t getEstAirtimeFor(int len_bytes) override;
+
+  /** \brief  MUST be called after changing any modem params (SF, BW, CR, preamble, etc) */
+  void resetAirtimeTable() { memset(_airtime_table, 0, sizeof(_airtime_table)); }
   bool startSendRaw(const uint8_t* bytes, int len) override;
   bool isSendComplete() override;
   void onSendFinished() override;
@@ -39,15 +71,22 @@ public:
 
   int getNoiseFloor() const override { return _noise_floor; }
   void triggerNoiseFloorCalibrate(int threshold) override;
+  const NoiseFloorTracker& getNoiseFloorTracker() const { return _floor_tracker; }
   void resetAGC() override;
+  void setTxPower(uint8_t dbm) override { _radio->setOutputPower((int8_t) dbm); }
+  void setRxDutyCycle(bool enable) override;
+  bool isSleepAllowed() const override;
 
   void loop() override;
 
   uint32_t getPacketsRecv() const { return n_recv; }
   uint32_t getPacketsSent() const { return n_sent; }
-  void resetStats() { n_recv = n_sent = 0; }
+  void resetStats() { n_recv = n_sent = 0; _floor_tracker.resetStats(); }
 
   virtual float getLastRSSI() const override;
+  uint32_t getLastRecvMicros() const override { return _rx_micros; }
+  uint32_t getLastSendMicros() const override { return _tx_start_micros; }
+  uint32_t getLastSendAirtimeMicros() const override { return _tx_air_micros; }
   virtual float getLastSNR() const override;
 
   float packetScore(float snr, int packet_len) override { return packetScoreInt(snr, 10, packet_len); }  // assume sf=10
@@ -6,6 +6,15 @@
 #define TELEM_WIRE &Wire  // Use default I2C bus for Environment Sensors
 #endif
 
+#define ENV_TASK_IDLE         0
+#define ENV_TASK_CONVERTING   1
+
+#define ENV_RETRY_MILLIS     10   // when a result isn't ready yet
+#define ENV_MAX_RETRIES      20
+
+#define AHTX0_CONVERSION_MILLIS   80
+#define VL53L0X_CONVERSION_MILLIS 35   // single-shot range, with default timing budget (33ms)
+
 #if ENV_INCLUDE_AHTX0
 #define TELEM_AHTX_ADDRESS      0x38      // AHT10, AHT20 temperature and humidity sensor I2C address
 #include <Adafruit_AHTX0.h>
@@ -74,6 +83,10 @@ static bool serialGPSFlag = false;
 static SFE_UBLOX_GNSS ublox_GNSS;
 #endif
 
+static uint32_t getConversionMillis(int id) {
+  return id == ENV_VL53L0X ? VL53L0X_CONVERSION_MILLIS : AHTX0_CONVERSION_MILLIS;
+}
+
 bool EnvironmentSensorManager::begin() {
   #if ENV_INCLUDE_GPS
   #if RAK_BOARD
@@ -185,9 +198,171 @@ bool EnvironmentSensorManager::begin() {
   }
   #endif
 
+  // setup scheduler, and take initial readings (blocking is fine here)
+  for (int id = 0; id < ENV_NUM_SENSORS; id++) {
+    auto t = &tasks[id];
+    memset(t, 0, sizeof(*t));
+    t->interval = id == ENV_INA3221 || id == ENV_INA219 ? ENV_POWER_POLL_MILLIS : (id == ENV_VL53L0X ? ENV_DISTANCE_POLL_MILLIS : ENV_POLL_MILLIS);
+    if (!isDetected(id)) continue;
+
+    if (startSensor(id)) delay(getConversionMillis(id));
+    t->valid = readSensor(id, t->vals);
+    t->next_at = millis() + (t->valid ? t->interval : ENV_RETRY_MILLIS);
+  }
+
   return true;
 }
 
+static float calcAltitude(float pressure_hpa, float sea_level_hpa) {   // same formula as the Adafruit libs
+  return 44330.0f * (1.0f - pow(pressure_hpa / sea_level_hpa, 0.1903f));
+}
+
+bool EnvironmentSensorManager::isDetected(int id) const {
+  switch (id) {
+    case ENV_AHTX0: return AHTX0_initialized;
+    case ENV_BME280: return BME280_initialized;
+    case ENV_BMP280: return BMP280_initialized;
+    case ENV_SHTC3: return SHTC3_initialized;
+    case ENV_LPS22HB: return LPS22HB_initialized;
+    case ENV_INA3221: return INA3221_initialized;
+    case ENV_INA219: return INA219_initialized;
+    case ENV_MLX90614: return MLX90614_initialized;
+    case ENV_VL53L0X: return VL53L0X_initialized;
+  }
+  return false;
+}
+
+// returns true if a conversion was started, and result should be collected later (with readSensor())
+bool EnvironmentSensorManager::startSensor(int id) {
+  #if ENV_INCLUDE_AHTX0
+  if (id == ENV_AHTX0) {   // trigger measurement directly, as library blocks for whole conversion
+    (TELEM_WIRE)->beginTransmission(TELEM_AHTX_ADDRESS);
+    (TELEM_WIRE)->write(0xAC);
+    (TELEM_WIRE)->write(0x33);
+    (TELEM_WIRE)->write(0x00);
+    return (TELEM_WIRE)->endTransmission() == 0;
+  }
+  #endif
+  #if ENV_INCLUDE_VL53L0X
+  if (id == ENV_VL53L0X) {   // single-shot, so sensor is idle (low power) between readings
+    return VL53L0X.startRange();
+  }
+  #endif
+  return false;   // other sensors are free-running, or only have a blocking read
+}
+
+// returns false if result is not ready yet
+bool EnvironmentSensorManager::readSensor(int id, float vals[]) {
+  switch (id) {
+  #if ENV_INCLUDE_AHTX0
+    case ENV_AHTX0: {
+      uint8_t buf[6];
+      if ((TELEM_WIRE)->requestFrom((uint8_t)TELEM_AHTX_ADDRESS, (uint8_t)6) != 6) return false;
+      for (int i = 0; i < 6; i++) buf[i] = (TELEM_WIRE)->read();
+      if (buf[0] & 0x80) return false;   // still busy
+
+      uint32_t h = ((uint32_t)buf[1] << 12) | ((uint32_t)buf[2] << 4) | (buf[3] >> 4);
+      uint32_t t = ((uint32_t)(buf[3] & 0x0F) << 16) | ((uint32_t)buf[4] << 8) | buf[5];
+      vals[0] = ((float)t * 200 / 0x100000) - 50;
+      vals[1] = (float)h * 100 / 0x100000;
+      return true;
+    }
+  #endif
+  #if ENV_INCLUDE_BME280
+    case ENV_BME280:   // NOTE: BME280 is in normal (continuous) mode, so these are just register reads
+      vals[0] = BME280.readTemperature();
+      vals[1] = BME280.readHumidity();
+      vals[2] = BME280.readPressure()/100;
+      vals[3] = calcAltitude(vals[2], TELEM_BME280_SEALEVELPRESSURE_HPA);
+      return true;
+  #endif
+  #if ENV_INCLUDE_BMP280
+    case ENV_BMP280:
+      vals[0] = BMP280.readTemperature();
+      vals[1] = BMP280.readPressure()/100;
+      vals[2] = calcAltitude(vals[1], TELEM_BMP280_SEALEVELPRESSURE_HPA);
+      return true;
+  #endif
+  #if ENV_INCLUDE_SHTC3
+    case ENV_SHTC3: {
+      sensors_event_t humidity, temp;
+      SHTC3.getEvent(&humidity, &temp);
+      vals[0] = temp.temperature;
+      vals[1] = humidity.relative_humidity;
+      return true;
+    }
+  #endif
+  #if ENV_INCLUDE_LPS22HB
+    case ENV_LPS22HB:
+      vals[0] = BARO.readTemperature();
+      vals[1] = BARO.readPressure();
+      return true;
+  #endif
+  #if ENV_INCLUDE_INA3221
+    case ENV_INA3221:
+      for (int i = 0; i < TELEM_INA3221_NUM_CHANNELS; i++) {
+        if (INA3221.isChannelEnabled(i)) {
+          vals[i*3] = INA3221.getBusVoltage(i);
+          vals[i*3 + 1] = INA3221.getCurrentAmps(i);
+          vals[i*3 + 2] = vals[i*3] * vals[i*3 + 1];
+        } else {
+          vals[i*3] = NAN;   // channel not enabled
+        }
+      }
+      return true;
+  #endif
+  #if ENV_INCLUDE_INA219
+    case ENV_INA219:
+      vals[0] = INA219.getBusVoltage_V();
+      vals[1] = INA219.getCurrent_mA() / 1000;
+      vals[2] = INA219.getPower_mW() / 1000;
+      return true;
+  #endif
+  #if ENV_INCLUDE_MLX90614
+    case ENV_MLX90614:
+      vals[0] = MLX90614.readObjectTempC();
+      vals[1] = MLX90614.readAmbientTempC();
+      return true;
+  #endif
+  #if ENV_INCLUDE_VL53L0X
+    case ENV_VL53L0X:   // single-shot range, see startSensor()
+      if (!VL53L0X.isRangeComplete()) return false;
+      vals[0] = VL53L0X.readRange() / 1000.0f;   // convert mm to m
+      if (VL53L0X.readRangeStatus() == 4) vals[0] = 0.0f;   // phase failures, no valid measurement
+      return true;
+  #endif
+  }
+  return true;
+}
+
+void EnvironmentSensorManager::pollSensors() {
+  unsigned long now = millis();
+  for (int k = 0; k < ENV_NUM_SENSORS; k++) {
+    int id = (next_task + k) % ENV_NUM_SENSORS;
+    auto t = &tasks[id];
+    if (!isDetected(id) || (long)(now - t->next_at) < 0) continue;   // not due yet
+
+    if (t->state == ENV_TASK_IDLE && startSensor(id)) {
+      t->state = ENV_TASK_CONVERTING;
+      t->retries = 0;
+      t->next_at = now + getConversionMillis(id);
+    } else if (readSensor(id, t->vals)) {
+      t->valid = true;
+      t->state = ENV_TASK_IDLE;
+      t->next_at = now + t->interval;
+    } else if (++t->retries < ENV_MAX_RETRIES) {
+      t->next_at = now + ENV_RETRY_MILLIS;   // not ready, check again shortly
+    } else {
+      MESH_DEBUG_PRINTLN("sensor %d: timed out", id);
+      t->state = ENV_TASK_IDLE;
+      t->retries = 0;
+      t->next_at = now + t->interval;
+    }
+    next_task = (id + 1) % ENV_NUM_SENSORS;
+    break;   // just one sensor step per loop(), to keep the radio serviced
+  }
+}
+
 bool EnvironmentSensorManager::querySensors(uint8_t requester_permissions, CayenneLPP& telemetry) {
   next_available_channel = TELEM_CHANNEL_SELF + 1;
 
@@ -196,60 +371,61 @@ bool EnvironmentSensorManager::querySensors(uint8_t requester_permissions, Cayen
   }
 
   if (requester_permissions & TELEM_PERM_ENVIRONMENT) {
+    // NOTE: all values come from cache, see pollSensors()
+    const float* v;
 
     #if ENV_INCLUDE_AHTX0
-    if (AHTX0_initialized) {
-      sensors_event_t humidity, temp;
-      AHTX0.getEvent(&humidity, &temp);
-      telemetry.addTemperature(TELEM_CHANNEL_SELF, temp.temperature);
-      telemetry.addRelativeHumidity(TELEM_CHANNEL_SELF, humidity.relative_humidity);
+    if (tasks[ENV_AHTX0].valid) {
+      v = tasks[ENV_AHTX0].vals;
+      telemetry.addTemperature(TELEM_CHANNEL_SELF, v[0]);
+      telemetry.addRelativeHumidity(TELEM_CHANNEL_SELF, v[1]);
     }
     #endif
 
     #if ENV_INCLUDE_BME280
-    if (BME280_initialized) {
-      telemetry.addTemperature(TELEM_CHANNEL_SELF, BME280.readTemperature());
-      telemetry.addRelativeHumidity(TELEM_CHANNEL_SELF, BME280.readHumidity());
-      telemetry.addBarometricPressure(TELEM_CHANNEL_SELF, BME280.readPressure()/100);
-      telemetry.addAltitude(TELEM_CHANNEL_SELF, BME280.readAltitude(TELEM_BME280_SEALEVELPRESSURE_HPA));
+    if (tasks[ENV_BME280].valid) {
+      v = tasks[ENV_BME280].vals;
+      telemetry.addTemperature(TELEM_CHANNEL_SELF, v[0]);
+      telemetry.addRelativeHumidity(TELEM_CHANNEL_SELF, v[1]);
+      telemetry.addBarometricPressure(TELEM_CHANNEL_SELF, v[2]);
+      telemetry.addAltitude(TELEM_CHANNEL_SELF, v[3]);
     }
     #endif
 
     #if ENV_INCLUDE_BMP280
-    if (BMP280_initialized) {
-      telemetry.addTemperature(TELEM_CHANNEL_SELF, BMP280.readTemperature());
-      telemetry.addBarometricPressure(TELEM_CHANNEL_SELF, BMP280.readPressure()/100);
-      telemetry.addAltitude(TELEM_CHANNEL_SELF, BME280.readAltitude(TELEM_BME280_SEALEVELPRESSURE_HPA));
+    if (tasks[ENV_BMP280].valid) {
+      v = tasks[ENV_BMP280].vals;
+      telemetry.addTemperature(TELEM_CHANNEL_SELF, v[0]);
+      telemetry.addBarometricPressure(TELEM_CHANNEL_SELF, v[1]);
+      telemetry.addAltitude(TELEM_CHANNEL_SELF, v[2]);
     }
     #endif
 
     #if ENV_INCLUDE_SHTC3
-    if (SHTC3_initialized) {
-      sensors_event_t humidity, temp;
-      SHTC3.getEvent(&humidity, &temp);
-
-      telemetry.addTemperature(TELEM_CHANNEL_SELF, temp.temperature);
-      telemetry.addRelativeHumidity(TELEM_CHANNEL_SELF, humidity.relative_humidity);
+    if (tasks[ENV_SHTC3].valid) {
+      v = tasks[ENV_SHTC3].vals;
+      telemetry.addTemperature(TELEM_CHANNEL_SELF, v[0]);
+      telemetry.addRelativeHumidity(TELEM_CHANNEL_SELF, v[1]);
     }
     #endif
 
     #if ENV_INCLUDE_LPS22HB
-    if (LPS22HB_initialized) {
-      telemetry.addTemperature(TELEM_CHANNEL_SELF, BARO.readTemperature());
-      telemetry.addBarometricPressure(TELEM_CHANNEL_SELF, BARO.readPressure());
+    if (tasks[ENV_LPS22HB].valid) {
+      v = tasks[ENV_LPS22HB].vals;
+      telemetry.addTemperature(TELEM_CHANNEL_SELF, v[0]);
+      telemetry.addBarometricPressure(TELEM_CHANNEL_SELF, v[1]);
     }
     #endif
 
     #if ENV_INCLUDE_INA3221
-    if (INA3221_initialized) {
+    if (tasks[ENV_INA3221].valid) {
+      v = tasks[ENV_INA3221].vals;
       for(int i = 0; i < TELEM_INA3221_NUM_CHANNELS; i++) {
         // add only enabled INA3221 channels to telemetry
-        if (INA3221.isChannelEnabled(i)) {
-          float voltage = INA3221.getBusVoltage(i);
-          float current = INA3221.getCurrentAmps(i);
-          telemetry.addVoltage(next_available_channel, voltage);
-          telemetry.addCurrent(next_available_channel, current);
-          telemetry.addPower(next_available_channel, voltage * current);
+        if (!isnan(v[i*3])) {
+          telemetry.addVoltage(next_available_channel, v[i*3]);
+          telemetry.addCurrent(next_available_channel, v[i*3 + 1]);
+          telemetry.addPower(next_available_channel, v[i*3 + 2]);
           next_available_channel++;
         }
       }
@@ -257,33 +433,28 @@ bool EnvironmentSensorManager::querySensors(uint8_t requester_permissions, Cayen
     #endif
 
     #if ENV_INCLUDE_INA219
-    if (INA219_initialized) {
-      telemetry.addVoltage(next_available_channel, INA219.getBusVoltage_V());
-      telemetry.addCurrent(next_available_channel, INA219.getCurrent_mA() / 1000);
-      telemetry.addPower(next_available_channel, INA219.getPower_mW() / 1000);
+    if (tasks[ENV_INA219].valid) {
+      v = tasks[ENV_INA219].vals;
+      telemetry.addVoltage(next_available_channel, v[0]);
+      telemetry.addCurrent(next_available_channel, v[1]);
+      telemetry.addPower(next_available_channel, v[2]);
       next_available_channel++;
     }
     #endif
 
     #if ENV_INCLUDE_MLX90614
-    if (MLX90614_initialized) {
-      telemetry.addTemperature(TELEM_CHANNEL_SELF, MLX90614.readObjectTempC());
-      telemetry.addTemperature(TELEM_CHANNEL_SELF + 1, MLX90614.readAmbientTempC());
+    if (tasks[ENV_MLX90614].valid) {
+      v = tasks[ENV_MLX90614].vals;
+      telemetry.addTemperature(TELEM_CHANNEL_SELF, v[0]);
+      telemetry.addTemperature(TELEM_CHANNEL_SELF + 1, v[1]);
     }
     #endif
 
     #if ENV_INCLUDE_VL53L0X
-    if (VL53L0X_initialized) {
-      VL53L0X_RangingMeasurementData_t measure;
-      VL53L0X.rangingTest(&measure, false); // pass in 'true' to get debug data
-      if (measure.RangeStatus != 4) { // phase failures
-        telemetry.addDistance(TELEM_CHANNEL_SELF, measure.RangeMilliMeter / 1000.0f); // convert mm to m
-      } else {
-        telemetry.addDistance(TELEM_CHANNEL_SELF, 0.0f); // no valid measurement
-      }
+    if (tasks[ENV_VL53L0X].valid) {
+      telemetry.addDistance(TELEM_CHANNEL_SELF, tasks[ENV_VL53L0X].vals[0]);
     }
     #endif
-
   }
 
   return true;
@@ -475,7 +646,12 @@ void EnvironmentSensorManager::stop_gps() {
   MESH_DEBUG_PRINTLN("Stop GPS is N/A on this board. Actual GPS state unchanged");
 }
 
+#endif
+
 void EnvironmentSensorManager::loop() {
+  pollSensors();
+
+  #if ENV_INCLUDE_GPS
   static long next_gps_update = 0;
 
   _location->loop();
@@ -505,5 +681,5 @@ void EnvironmentSensorManager::loop() {
     }
     next_gps_update = millis() + 1000;
   }
+  #endif
 }
-#endif
@@ -4,10 +4,47 @@
 #include <helpers/SensorManager.h>
 #include <helpers/sensors/LocationProvider.h>
 
+#ifndef ENV_POLL_MILLIS
+  #define ENV_POLL_MILLIS           30000   // default interval between reads of each environment sensor
+#endif
+#ifndef ENV_POWER_POLL_MILLIS
+  #define ENV_POWER_POLL_MILLIS     10000   // INA219 / INA3221
+#endif
+#ifndef ENV_DISTANCE_POLL_MILLIS
+  #define ENV_DISTANCE_POLL_MILLIS   5000   // VL53L0X
+#endif
+
+#define ENV_MAX_VALUES   9   // per sensor (INA3221 is 3 channels x V,I,P)
+
+enum EnvSensorId {
+  ENV_AHTX0, ENV_BME280, ENV_BMP280, ENV_SHTC3, ENV_LPS22HB, ENV_INA3221, ENV_INA219, ENV_MLX90614, ENV_VL53L0X,
+  ENV_NUM_SENSORS
+};
+
+/**
+ * \brief  scheduler state for one sensor. Readings are cached in vals[], so telemetry requests never touch the I2C bus.
+*/
+struct EnvSensorTask {
+  uint8_t state;           // ENV_TASK_*
+  uint8_t retries;
+  bool valid;              // vals[] holds a reading
+  unsigned long next_at;   // millis() when next step is due
+  uint32_t interval;       // millis between reads
+  float vals[ENV_MAX_VALUES];
+};
+
 class EnvironmentSensorManager : public SensorManager {
 protected:
   int next_available_channel = TELEM_CHANNEL_SELF + 1;
 
+  EnvSensorTask tasks[ENV_NUM_SENSORS];
+  int next_task = 0;
+
+  bool isDetected(int id) const;
+  bool startSensor(int id);
+  bool readSensor(int id, float vals[]);
+  void pollSensors();
+
   bool AHTX0_initialized = false;
   bool BME280_initialized = false;
   bool BMP280_initialized = false;
@@ -41,9 +78,7 @@ public:
   #endif
   bool begin() override;
   bool querySensors(uint8_t requester_permissions, CayenneLPP& telemetry) override;
-  #if ENV_INCLUDE_GPS
   void loop() override;
-  #endif
   int getNumSettings() const override;
   const char* getSettingName(int i) const override;
   const char* getSettingValue(int i) const override;
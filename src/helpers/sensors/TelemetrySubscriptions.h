@@ -0,0 +1,130 @@
+#pragma once
+
+#include <Arduino.h>
+#include <helpers/sensors/LPPDataHelpers.h>
+
+#ifndef MAX_TELEM_SUBSCRIPTIONS
+  #define MAX_TELEM_SUBSCRIPTIONS   8
+#endif
+
+#define TELEM_SUB_KEY_SIZE   4   // subscriber is identified by pub_key prefix
+
+struct TelemSubscription {
+  uint8_t  key[TELEM_SUB_KEY_SIZE];   // all zero if slot is free
+  uint32_t tag;          // chosen by subscriber, is prefixed to each push (like a request tag)
+  uint8_t  channel, lpp_type;
+  float    deadband;     // push when value moves at least this far from last pushed value
+  uint16_t min_secs;     // never push more often than this
+  uint16_t max_secs;     // push at least this often, even if unchanged (zero to disable)
+  uint32_t last_sent;    // by our RTC clock
+  float    last_value;
+
+  bool isActive() const { return key[0] | key[1] | key[2] | key[3]; }
+};
+
+/**
+ * \brief  Table of telemetry 'push' subscriptions. The app periodically passes its current telemetry (CayenneLPP)
+ *         to nextPush(), and sends whatever it returns to the given subscriber.
+*/
+class TelemetrySubscriptions {
+  TelemSubscription _subs[MAX_TELEM_SUBSCRIPTIONS];
+
+  bool isDue(const TelemSubscription& s, uint32_t now, float value) const {
+    uint32_t elapsed = now - s.last_sent;
+    if (s.max_secs > 0 && elapsed >= s.max_secs) return true;
+    if (elapsed < s.min_secs) return false;
+    return isnan(s.last_value) || fabs(value - s.last_value) >= s.deadband;
+  }
+
+public:
+  TelemetrySubscriptions() { memset(_subs, 0, sizeof(_subs)); }
+
+  /**
+   * \brief  adds (or updates) the rule for this subscriber + channel + type.
+   * \returns  false if table is full
+  */
+  bool subscribe(const uint8_t* key, uint32_t tag, uint8_t channel, uint8_t lpp_type, float deadband, uint16_t min_secs, uint16_t max_secs) {
+    TelemSubscription* slot = NULL;
+    for (int i = 0; i < MAX_TELEM_SUBSCRIPTIONS; i++) {
+      auto s = &_subs[i];
+      if (s->isActive()) {
+        if (memcmp(s->key, key, TELEM_SUB_KEY_SIZE) == 0 && s->channel == channel && s->lpp_type == lpp_type) {
+          slot = s;  // replace existing rule
+          break;
+        }
+      } else if (slot == NULL) {
+        slot = s;
+      }
+    }
+    if (slot == NULL) return false;
+
+    memcpy(slot->key, key, TELEM_SUB_KEY_SIZE);
+    slot->tag = tag;
+    slot->channel = channel;
+    slot->lpp_type = lpp_type;
+    slot->deadband = deadband;
+    slot->min_secs = min_secs;
+    slot->max_secs = max_secs;
+    slot->last_sent = 0;
+    slot->last_value = NAN;   // so first evaluation pushes
+    return true;
+  }
+
+  int unsubscribe(const uint8_t* key) {
+    int n = 0;
+    for (int i = 0; i < MAX_TELEM_SUBSCRIPTIONS; i++) {
+      if (_subs[i].isActive() && memcmp(_subs[i].key, key, TELEM_SUB_KEY_SIZE) == 0) {
+        memset(&_subs[i], 0, sizeof(_subs[i]));
+        n++;
+      }
+    }
+    return n;
+  }
+
+  bool isEmpty() const {
+    for (int i = 0; i < MAX_TELEM_SUBSCRIPTIONS; i++) {
+      if (_subs[i].isActive()) return false;
+    }
+    return true;
+  }
+
+  int count(const uint8_t* key) const {
+    int n = 0;
+    for (int i = 0; i < MAX_TELEM_SUBSCRIPTIONS; i++) {
+      if (_subs[i].isActive() && memcmp(_subs[i].key, key, TELEM_SUB_KEY_SIZE) == 0) n++;
+    }
+    return n;
+  }
+
+  /**
+   * \brief  finds next subscriber with any due rules, and copies the matching LPP records (for ALL of that subscriber's
+   *         due rules) to dest. Due rules are marked as sent. Call repeatedly until it returns zero.
+   * \param  key_out  pub_key prefix of subscriber (TELEM_SUB_KEY_SIZE bytes)
+   * \returns  length of LPP data in dest, or zero if nothing more to push
+  */
+  int nextPush(uint32_t now, const uint8_t* lpp, int lpp_len, uint8_t* key_out, uint32_t& tag_out, uint8_t* dest, int dest_max) {
+    int len = 0;
+    bool found = false;
+    for (int i = 0; i < MAX_TELEM_SUBSCRIPTIONS; i++) {
+      auto s = &_subs[i];
+      if (!s->isActive() || (found && memcmp(s->key, key_out, TELEM_SUB_KEY_SIZE) != 0)) continue;
+
+      int ofs = findLPPRecord(lpp, lpp_len, s->channel, s->lpp_type);
+      if (ofs < 0) continue;  // not in current telemetry
+
+      uint8_t sz = getDataSize(s->lpp_type);
+      float value = getFloat(&lpp[ofs + 2], sz, getMultiplier(s->lpp_type), isSigned(s->lpp_type));
+      if (!isDue(*s, now, value) || len + 2 + sz > dest_max) continue;
+
+      if (!found) {   // first due rule determines which subscriber this push is for
+        found = true;
+        memcpy(key_out, s->key, TELEM_SUB_KEY_SIZE);
+        tag_out = s->tag;
+      }
+      memcpy(&dest[len], &lpp[ofs], 2 + sz); len += 2 + sz;
+      s->last_sent = now;
+      s->last_value = value;
+    }
+    return len;
+  }
+};
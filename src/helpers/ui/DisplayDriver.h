@@ -1,17 +1,113 @@
 #pragma once
 
 #include <stdint.h>
+#include <string.h>
+
+#ifndef DISPLAY_DIRTY_BANDS
+  #define DISPLAY_DIRTY_BANDS   16   // granularity of frame signatures (horizontal bands)
+#endif
+
+typedef void (*DisplayBusyCallback)(void* ctx);
 
 class DisplayDriver {
   int _w, _h;
+  DisplayBusyCallback _busy_fn;
+  void* _busy_ctx;
+  bool _in_busy;
+  uint32_t _band_sigs[DISPLAY_DIRTY_BANDS];
+  uint32_t _sent_sigs[DISPLAY_DIRTY_BANDS];   // of the frame currently on the panel
+  bool _sent_valid;
+
+  static uint32_t fnv1a(uint32_t h, const void* data, size_t len) {
+    const uint8_t* p = (const uint8_t*) data;
+    while (len--) { h ^= *p++; h *= 16777619UL; }
+    return h;
+  }
 protected:
-  DisplayDriver(int w, int h) { _w = w; _h = h; }
+  DisplayDriver(int w, int h) { _w = w; _h = h; _busy_fn = NULL; _in_busy = false; _sent_valid = false; resetFrameSig(); }
+
+  // for backends to call repeatedly while blocked waiting on the panel
+  void onBusy() {
+    if (_busy_fn && !_in_busy) {   // callback must never recurse back into display
+      _in_busy = true;
+      _busy_fn(_busy_ctx);
+      _in_busy = false;
+    }
+  }
+
+  /*
+   * Frame signatures, for backends which can't read back their framebuffer. Each draw op folds a hash of its
+   * params into the bands it covers (logical coords), so at endFrame() the bands which differ from the last
+   * sent frame tell which rows need to go to the panel.
+   */
+  void resetFrameSig() { memset(_band_sigs, 0, sizeof(_band_sigs)); }
+  void invalidateFrameSig() { _sent_valid = false; }   // next frame is sent in full
+
+  void addFrameSig(int x, int y, int w, int h, const void* data, size_t len) {
+    int band_h = (_h + DISPLAY_DIRTY_BANDS - 1) / DISPLAY_DIRTY_BANDS;
+    int b0 = y < 0 ? 0 : y / band_h;
+    int b1 = (y + h - 1) / band_h;
+    if (b1 >= DISPLAY_DIRTY_BANDS) b1 = DISPLAY_DIRTY_BANDS - 1;
+
+    int32_t params[4] = { x, y, w, h };
+    uint32_t sig = fnv1a(fnv1a(2166136261UL, params, sizeof(params)), data, len);
+    for (int b = b0; b <= b1; b++) {
+      _band_sigs[b] = (_band_sigs[b] * 31) ^ sig;
+    }
+  }
+
+  /**
+   * \brief  compares this frame's signatures with the last sent frame, and marks this frame as sent.
+   * \returns  false if frame is unchanged, otherwise the [y0, y1) range of logical rows that changed.
+  */
+  bool getChangedRows(int& y0, int& y1) {
+    int band_h = (_h + DISPLAY_DIRTY_BANDS - 1) / DISPLAY_DIRTY_BANDS;
+    int b0 = -1, b1 = -1;
+    for (int b = 0; b < DISPLAY_DIRTY_BANDS; b++) {
+      if (!_sent_valid || _band_sigs[b] != _sent_sigs[b]) {
+        if (b0 < 0) b0 = b;
+        b1 = b;
+      }
+    }
+    memcpy(_sent_sigs, _band_sigs, sizeof(_sent_sigs));
+    _sent_valid = true;
+    if (b0 < 0) return false;
+
+    y0 = b0 * band_h;
+    y1 = (b1 + 1) * band_h;
+    if (y1 > _h) y1 = _h;
+    return true;
+  }
+
+  /**
+   * \brief  for page-format framebuffers (8 rows per byte, SSD1306 style). Compares one page with the shadow copy
+   *      of what was last sent, and updates the shadow.
+   * \returns  true if page changed, with [x0, x1] the range of changed columns
+  */
+  static bool diffPage(const uint8_t* page, uint8_t* shadow, int width, int& x0, int& x1) {
+    x0 = -1;
+    for (int x = 0; x < width; x++) {
+      if (page[x] != shadow[x]) {
+        if (x0 < 0) x0 = x;
+        x1 = x;
+        shadow[x] = page[x];
+      }
+    }
+    return x0 >= 0;
+  }
+
 public:
   enum Color { DARK=0, LIGHT, RED, GREEN, BLUE, YELLOW, ORANGE }; // on b/w screen, colors will be !=0 synonym of light
 
   int width() const { return _w; }
   int height() const { return _h; }
 
+  /**
+   * \brief  slow panels (e-paper) will call this repeatedly while waiting for a refresh to complete, so that
+   *        the app can keep servicing the radio. It must NOT draw to this display.
+  */
+  void setBusyCallback(DisplayBusyCallback fn, void* ctx) { _busy_fn = fn; _busy_ctx = ctx; }
+
   virtual bool isOn() = 0;
   virtual void turnOn() = 0;
   virtual void turnOff() = 0;
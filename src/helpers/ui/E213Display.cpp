@@ -47,9 +47,13 @@ void E213Display::turnOff() {
 
 void E213Display::clear() {
   display.clear();
+  invalidateFrameSig();
 }
 
 void E213Display::startFrame(Color bkg) {
+  resetFrameSig();
+  addFrameSig(0, 0, width(), height(), &bkg, sizeof(bkg));
+
   // Fill screen with white first to ensure clean background
   display.fillRect(0, 0, width(), height(), WHITE);
   if (bkg == LIGHT) {
@@ -72,18 +76,27 @@ void E213Display::setCursor(int x, int y) {
 }
 
 void E213Display::print(const char *str) {
+  int16_t x1, y1;
+  uint16_t w, h;
+  display.getTextBounds(str, display.getCursorX(), display.getCursorY(), &x1, &y1, &w, &h);
+  addFrameSig(display.getCursorX(), y1, w, h, str, strlen(str));
+
   display.print(str);
 }
 
 void E213Display::fillRect(int x, int y, int w, int h) {
+  addFrameSig(x, y, w, h, "F", 1);
   display.fillRect(x, y, w, h, BLACK);
 }
 
 void E213Display::drawRect(int x, int y, int w, int h) {
+  addFrameSig(x, y, w, h, "R", 1);
   display.drawRect(x, y, w, h, BLACK);
 }
 
 void E213Display::drawXbm(int x, int y, const uint8_t *bits, int w, int h) {
+  addFrameSig(x, y, w, h, bits, ((w + 7) / 8) * h);
+
   // Width in bytes for bitmap processing
   uint16_t widthInBytes = (w + 7) / 8;
 
@@ -112,5 +125,15 @@ uint16_t E213Display::getTextWidth(const char *str) {
 }
 
 void E213Display::endFrame() {
-  display.update();
+  int y0, y1;
+  if (!getChangedRows(y0, y1)) return;   // panel already shows this frame, skip the (blocking) refresh
+
+  if (++_num_partial >= EPD_FULL_REFRESH_EVERY) {   // fastmode refreshes slowly build up ghosting, so clear it
+    _num_partial = 0;
+    display.fastmodeOff();
+    display.update();
+    display.fastmodeOn();
+  } else {
+    display.update();
+  }
 }
@@ -6,11 +6,16 @@
 #include <Wire.h>
 #include <heltec-eink-modules.h>
 
+#ifndef EPD_FULL_REFRESH_EVERY
+  #define EPD_FULL_REFRESH_EVERY   30   // partial (fastmode) refreshes between full (ghost clearing) refreshes
+#endif
+
 // Display driver for E213 e-ink display
 class E213Display : public DisplayDriver {
   EInkDisplay_VisionMasterE213 display;
   bool _init = false;
   bool _isOn = false;
+  uint8_t _num_partial = 0;
 
 public:
   E213Display() : DisplayDriver(250, 122) {}
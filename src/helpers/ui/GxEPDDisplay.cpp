@@ -12,12 +12,15 @@ bool GxEPDDisplay::begin() {
   display.epd2.selectSPI(SPI1, SPISettings(4000000, MSBFIRST, SPI_MODE0));
   SPI1.begin();
   display.init(115200, true, 2, false);
+  display.epd2.setBusyCallback(busyCallback, this);
   display.setRotation(DISPLAY_ROTATION);
   setTextSize(1);  // Default to size 1
   display.setPartialWindow(0, 0, display.width(), display.height());
 
   display.fillScreen(GxEPD_WHITE);
   display.display(true);
+  invalidateFrameSig();
+  _num_partial = 0;
   #if DISP_BACKLIGHT
   pinMode(DISP_BACKLIGHT, OUTPUT);
   #endif
@@ -43,10 +46,12 @@ void GxEPDDisplay::turnOff() {
 void GxEPDDisplay::clear() {
   display.fillScreen(GxEPD_WHITE);
   display.setTextColor(GxEPD_BLACK);
+  invalidateFrameSig();
 }
 
 void GxEPDDisplay::startFrame(Color bkg) {
   display.fillScreen(GxEPD_WHITE);
+  resetFrameSig();
 }
 
 void GxEPDDisplay::setTextSize(int sz) {
@@ -75,18 +80,27 @@ void GxEPDDisplay::setCursor(int x, int y) {
 }
 
 void GxEPDDisplay::print(const char* str) {
+  int16_t x1, y1;
+  uint16_t w, h;
+  display.getTextBounds(str, display.getCursorX(), display.getCursorY(), &x1, &y1, &w, &h);
+  addFrameSig(display.getCursorX(), y1 / SCALE_Y, w, h / SCALE_Y + 2, str, strlen(str));
+
   display.print(str);
 }
 
 void GxEPDDisplay::fillRect(int x, int y, int w, int h) {
+  addFrameSig(x, y, w, h, "F", 1);
   display.fillRect(x*SCALE_X, y*SCALE_Y, w*SCALE_X, h*SCALE_Y, GxEPD_BLACK);
 }
 
 void GxEPDDisplay::drawRect(int x, int y, int w, int h) {
+  addFrameSig(x, y, w, h, "R", 1);
   display.drawRect(x*SCALE_X, y*SCALE_Y, w*SCALE_X, h*SCALE_Y, GxEPD_BLACK);
 }
 
 void GxEPDDisplay::drawXbm(int x, int y, const uint8_t* bits, int w, int h) {
+  addFrameSig(x, y, w, h, bits, ((w + 7) / 8) * h);
+
   // Calculate the base position in display coordinates
   uint16_t startX = x * SCALE_X;
   uint16_t startY = y * SCALE_Y;
@@ -130,5 +144,18 @@ uint16_t GxEPDDisplay::getTextWidth(const char* str) {
 }
 
 void GxEPDDisplay::endFrame() {
-  display.display(true);
+  int y0, y1;
+  if (!getChangedRows(y0, y1)) return;   // panel already shows this frame
+
+  if (++_num_partial >= EPD_FULL_REFRESH_EVERY) {   // partial refreshes slowly build up ghosting, so clear it
+    _num_partial = 0;
+    display.display(false);
+    return;
+  }
+
+  // partial refresh of just the band of rows that changed
+  int py0 = y0 * SCALE_Y;
+  int py1 = y1 * SCALE_Y + 1;
+  if (py1 > display.height()) py1 = display.height();
+  display.displayWindow(0, py0, display.width(), py1 - py0);
 }
@@ -20,6 +20,10 @@
 
 #include "DisplayDriver.h"
 
+#ifndef EPD_FULL_REFRESH_EVERY
+  #define EPD_FULL_REFRESH_EVERY   30   // partial refreshes between full (ghost clearing) refreshes
+#endif
+
 //GxEPD2_BW<GxEPD2_150_BN, 200> display(GxEPD2_150_BN(DISP_CS, DISP_DC, DISP_RST, DISP_BUSY)); // DEPG0150BN 200x200, SSD1681, TTGO T5 V2.4.1
 
 
@@ -28,6 +32,9 @@ class GxEPDDisplay : public DisplayDriver {
   GxEPD2_BW<GxEPD2_150_BN, 200> display;
   bool _init = false;
   bool _isOn = false;
+  uint8_t _num_partial = 0;
+
+  static void busyCallback(const void* p) { ((GxEPDDisplay *) p)->onBusy(); }
 
 public:
   // there is a margin in y...
@@ -48,6 +48,9 @@ OLEDDisplay::OLEDDisplay() {
 	fontData = ArialMT_Plain_10;
 	fontTableLookupFunction = DefaultFontTableLookup;
 	buffer = NULL;
+	memset(layoutCache, 0, sizeof(layoutCache));
+	memset(&layoutTemp, 0, sizeof(layoutTemp));
+	layoutClock = 0;
 #ifdef OLEDDISPLAY_DOUBLE_BUFFER
 	buffer_back = NULL;
 #endif
@@ -116,6 +119,7 @@ void OLEDDisplay::end() {
   if (this->buffer_back) { free(this->buffer_back - BufferOffset); this->buffer_back = NULL; }
   #endif
   if (this->logBuffer != NULL) { free(this->logBuffer); this->logBuffer = NULL; }
+  clearLayoutCache();
 }
 
 void OLEDDisplay::resetDisplay(void) {
@@ -618,37 +622,29 @@ uint16_t OLEDDisplay::drawStringInternal(int16_t xMove, int16_t yMove, const cha
 
 
 uint16_t OLEDDisplay::drawString(int16_t xMove, int16_t yMove, const String &strUser) {
-  uint16_t lineHeight = pgm_read_byte(fontData + HEIGHT_POS);
+  return drawString(xMove, yMove, strUser.c_str());
+}
 
-  // char* text must be freed!
-  char* text = strdup(strUser.c_str());
-  if (!text) {
-    DEBUG_OLEDDISPLAY("[OLEDDISPLAY][drawString] Can't allocate char array.\n");
+uint16_t OLEDDisplay::drawString(int16_t xMove, int16_t yMove, const char* text) {
+  const OLEDDisplayTextLayout* layout = getTextLayout(text, 0);
+  if (!layout) {
+    DEBUG_OLEDDISPLAY("[OLEDDISPLAY][drawString] Can't allocate text layout.\n");
     return 0;
   }
+  uint16_t lineHeight = pgm_read_byte(fontData + HEIGHT_POS);
 
   uint16_t yOffset = 0;
   // If the string should be centered vertically too
   // we need to now how heigh the string is.
   if (textAlignment == TEXT_ALIGN_CENTER_BOTH) {
-    uint16_t lb = 0;
-    // Find number of linebreaks in text
-    for (uint16_t i=0;text[i] != 0; i++) {
-      lb += (text[i] == 10);
-    }
-    // Calculate center
-    yOffset = (lb * lineHeight) / 2;
+    yOffset = (layout->lineBreaks * lineHeight) / 2;
   }
 
   uint16_t charDrawn = 0;
-  uint16_t line = 0;
-  char* textPart = strtok(text,"\n");
-  while (textPart != NULL) {
-    uint16_t length = strlen(textPart);
-    charDrawn += drawStringInternal(xMove, yMove - yOffset + (line++) * lineHeight, textPart, length, getStringWidth(textPart, length, true), true);
-    textPart = strtok(NULL, "\n");
+  for (uint16_t line = 0; line < layout->numLines; line++) {
+    const OLEDDisplayTextLine* l = &layout->lines[line];
+    charDrawn += drawStringInternal(xMove, yMove - yOffset + line * lineHeight, &text[l->start], l->length, l->width, true);
   }
-  free(text);
   return charDrawn;
 }
 
@@ -662,20 +658,78 @@ void OLEDDisplay::drawStringf( int16_t x, int16_t y, char* buffer, String format
 }
 
 uint16_t OLEDDisplay::drawStringMaxWidth(int16_t xMove, int16_t yMove, uint16_t maxLineWidth, const String &strUser) {
-  uint16_t firstChar  = pgm_read_byte(fontData + FIRST_CHAR_POS);
+  return drawStringMaxWidth(xMove, yMove, maxLineWidth, strUser.c_str());
+}
+
+uint16_t OLEDDisplay::drawStringMaxWidth(int16_t xMove, int16_t yMove, uint16_t maxLineWidth, const char* text) {
+  const OLEDDisplayTextLayout* layout = getTextLayout(text, maxLineWidth);
+  if (!layout) {
+    DEBUG_OLEDDISPLAY("[OLEDDISPLAY][drawStringMaxWidth] Can't allocate text layout.\n");
+    return 0;
+  }
   uint16_t lineHeight = pgm_read_byte(fontData + HEIGHT_POS);
 
-  const char* text = strUser.c_str();
+  uint16_t lineNumber = 0;
+  uint16_t drawStringResult = 1; // later tested for 0 == error, so initialize to 1
+  while (drawStringResult != 0 && lineNumber < layout->numLines) {
+    const OLEDDisplayTextLine* l = &layout->lines[lineNumber];
+    drawStringResult = drawStringInternal(xMove, yMove + lineNumber * lineHeight, &text[l->start], l->length, l->width, true);
+    lineNumber++;
+  }
 
-  uint16_t length = strlen(text);
+  if (drawStringResult == 0 || (yMove + lineNumber * lineHeight) >= this->height()) // text did not fit on screen
+    return layout->firstLineChars;
+  return 0; // everything was drawn
+}
+
+bool OLEDDisplay::addLayoutLine(OLEDDisplayTextLayout* layout, uint16_t& capacity, uint16_t start, uint16_t length, uint16_t width) {
+  if (layout->numLines >= capacity) {
+    OLEDDisplayTextLine* lines = (OLEDDisplayTextLine*) realloc(layout->lines, (capacity + 4) * sizeof(OLEDDisplayTextLine));
+    if (!lines) return false;
+    layout->lines = lines;
+    capacity += 4;
+  }
+  OLEDDisplayTextLine* l = &layout->lines[layout->numLines++];
+  l->start = start;
+  l->length = length;
+  l->width = width;
+  return true;
+}
+
+bool OLEDDisplay::layoutText(OLEDDisplayTextLayout* layout, const char* text) {
+  uint16_t length = layout->textLength;
+  uint16_t capacity = 0;
+  free(layout->lines);
+  layout->lines = NULL;
+  layout->numLines = 0;
+  layout->firstLineChars = 0;
+  layout->lineBreaks = 0;
+
+  if (layout->maxLineWidth == 0) {
+    // drawString(): one line per non-empty '\n' separated part (same as strtok)
+    uint16_t i = 0;
+    while (i < length) {
+      if (text[i] == '\n') {
+        layout->lineBreaks++;
+        i++;
+        continue;
+      }
+      uint16_t start = i;
+      while (i < length && text[i] != '\n') i++;
+      if (!addLayoutLine(layout, capacity, start, i - start, getStringWidth(&text[start], i - start, true))) return false;
+    }
+    return true;
+  }
+
+  // drawStringMaxWidth(): word wrap
+  uint16_t firstChar  = pgm_read_byte(fontData + FIRST_CHAR_POS);
+  uint16_t maxLineWidth = layout->maxLineWidth;
   uint16_t lastDrawnPos = 0;
-  uint16_t lineNumber = 0;
   uint16_t strWidth = 0;
 
   uint16_t preferredBreakpoint = 0;
   uint16_t widthAtBreakpoint = 0;
-  uint16_t firstLineChars = 0;
-  uint16_t drawStringResult = 1; // later tested for 0 == error, so initialize to 1
+  bool firstLine = true;
 
   for (uint16_t i = 0; i < length; i++) {
     char c = (this->fontTableLookupFunction)(text[i]);
@@ -685,14 +739,13 @@ uint16_t OLEDDisplay::drawStringMaxWidth(int16_t xMove, int16_t yMove, uint16_t
 
     // Always break on newline
     if (text[i] == '\n') {
-      drawStringResult = drawStringInternal(xMove, yMove + (lineNumber++) * lineHeight , &text[lastDrawnPos], i - lastDrawnPos, strWidth, true);
-      if (firstLineChars == 0)
-        firstLineChars = i;
-        
+      if (!addLayoutLine(layout, capacity, lastDrawnPos, i - lastDrawnPos, strWidth)) return false;
+      if (firstLine)
+        layout->firstLineChars = i;
+      firstLine = false;
+
       lastDrawnPos = i + 1;
       strWidth = 0;
-      if (drawStringResult == 0) // we are past the display already?
-        break;
     }
 
     // Always try to break on a space, dash or slash
@@ -706,28 +759,73 @@ uint16_t OLEDDisplay::drawStringMaxWidth(int16_t xMove, int16_t yMove, uint16_t
         preferredBreakpoint = i;
         widthAtBreakpoint = strWidth;
       }
-      drawStringResult = drawStringInternal(xMove, yMove + (lineNumber++) * lineHeight , &text[lastDrawnPos], preferredBreakpoint - lastDrawnPos, widthAtBreakpoint, true);
-      if (firstLineChars == 0)
-        firstLineChars = preferredBreakpoint;
+      if (!addLayoutLine(layout, capacity, lastDrawnPos, preferredBreakpoint - lastDrawnPos, widthAtBreakpoint)) return false;
+      if (firstLine)
+        layout->firstLineChars = preferredBreakpoint;
+      firstLine = false;
       lastDrawnPos = preferredBreakpoint;
       // It is possible that we did not draw all letters to i so we need
       // to account for the width of the chars from `i - preferredBreakpoint`
       // by calculating the width we did not draw yet.
       strWidth = strWidth - widthAtBreakpoint;
       preferredBreakpoint = 0;
-      if (drawStringResult == 0) // we are past the display already?
-        break;
     }
   }
 
-  // Draw last part if needed
-  if (drawStringResult != 0 && lastDrawnPos < length) {
-    drawStringResult = drawStringInternal(xMove, yMove + (lineNumber++) * lineHeight , &text[lastDrawnPos], length - lastDrawnPos, getStringWidth(&text[lastDrawnPos], length - lastDrawnPos, true), true);
+  // Last part, if needed
+  if (lastDrawnPos < length) {
+    if (!addLayoutLine(layout, capacity, lastDrawnPos, length - lastDrawnPos, getStringWidth(&text[lastDrawnPos], length - lastDrawnPos, true))) return false;
   }
+  return true;
+}
 
-  if (drawStringResult == 0 || (yMove + lineNumber * lineHeight) >= this->height()) // text did not fit on screen
-    return firstLineChars;
-  return 0; // everything was drawn
+const OLEDDisplayTextLayout* OLEDDisplay::getTextLayout(const char* text, uint16_t maxLineWidth) {
+  uint16_t length = strlen(text);
+  uint32_t hash = 2166136261UL;   // FNV-1a
+  for (uint16_t i = 0; i < length; i++) {
+    hash ^= (uint8_t) text[i];
+    hash *= 16777619UL;
+  }
+  if (hash == 0) hash = 1;   // zero marks an unused entry
+
+  OLEDDisplayTextLayout* layout = &layoutTemp;
+#if OLEDDISPLAY_LAYOUT_CACHE_SIZE > 0
+  if (length <= OLEDDISPLAY_LAYOUT_MAX_TEXT) {   // too long to keep a copy to compare against, so don't cache
+    layout = &layoutCache[0];
+    for (int i = 0; i < OLEDDISPLAY_LAYOUT_CACHE_SIZE; i++) {
+      OLEDDisplayTextLayout* l = &layoutCache[i];
+      if (l->hash == hash && l->textLength == length && l->font == fontData && l->maxLineWidth == maxLineWidth
+          && memcmp(l->text, text, length) == 0) {
+        l->lastUsed = ++layoutClock;
+        return l;   // cache hit
+      }
+      if (l->hash == 0 || (layout->hash != 0 && l->lastUsed < layout->lastUsed)) {
+        layout = l;   // unused, or least recently used so far
+      }
+    }
+    memcpy(layout->text, text, length);
+  }
+#endif
+
+  layout->hash = hash;
+  layout->font = fontData;
+  layout->textLength = length;
+  layout->maxLineWidth = maxLineWidth;
+  layout->lastUsed = ++layoutClock;
+  if (!layoutText(layout, text)) {
+    layout->hash = 0;
+    return NULL;
+  }
+  return layout;
+}
+
+void OLEDDisplay::clearLayoutCache() {
+  for (int i = 0; i < OLEDDISPLAY_LAYOUT_CACHE_SIZE; i++) {
+    free(layoutCache[i].lines);
+  }
+  free(layoutTemp.lines);
+  memset(layoutCache, 0, sizeof(layoutCache));
+  memset(&layoutTemp, 0, sizeof(layoutTemp));
 }
 
 uint16_t OLEDDisplay::getStringWidth(const char* text, uint16_t length, bool utf8) {
@@ -1150,6 +1248,7 @@ char* OLEDDisplay::utf8ascii(const String &str) {
 
 void OLEDDisplay::setFontTableLookupFunction(FontTableLookupFunction function) {
   this->fontTableLookupFunction = function;
+  clearLayoutCache();   // cached widths depend on the lookup
 }
 
 
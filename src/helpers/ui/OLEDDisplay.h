@@ -77,6 +77,16 @@ private:
 #define OLEDDISPLAY_DOUBLE_BUFFER
 #endif
 
+// Number of measured/wrapped strings remembered between frames (0 to disable)
+#ifndef OLEDDISPLAY_LAYOUT_CACHE_SIZE
+#define OLEDDISPLAY_LAYOUT_CACHE_SIZE 8
+#endif
+
+// Longest string (in bytes) kept in the layout cache, longer ones are laid out every time
+#ifndef OLEDDISPLAY_LAYOUT_MAX_TEXT
+#define OLEDDISPLAY_LAYOUT_MAX_TEXT 64
+#endif
+
 // Header Values
 #define JUMPTABLE_BYTES 4
 
@@ -154,6 +164,27 @@ enum HW_I2C {
 typedef char (*FontTableLookupFunction)(const uint8_t ch);
 char DefaultFontTableLookup(const uint8_t ch);
 
+// One line of laid out text, as offsets into the original (utf-8) string
+struct OLEDDisplayTextLine {
+  uint16_t start;
+  uint16_t length;
+  uint16_t width;
+};
+
+// The result of measuring and line breaking a string, so it can be redrawn without doing it again
+struct OLEDDisplayTextLayout {
+  uint32_t              hash;            // of text, 0 if entry is unused
+  const uint8_t        *font;
+  uint16_t              textLength;
+  uint16_t              maxLineWidth;    // 0 if only broken at '\n' (drawString)
+  uint16_t              firstLineChars;  // as returned by drawStringMaxWidth()
+  uint16_t              lineBreaks;      // number of '\n', for TEXT_ALIGN_CENTER_BOTH
+  uint16_t              numLines;
+  uint32_t              lastUsed;
+  OLEDDisplayTextLine  *lines;
+  char                  text[OLEDDISPLAY_LAYOUT_MAX_TEXT];   // copy of the cached text, compared on lookup
+};
+
 
 #ifdef ARDUINO
 class OLEDDisplay : public Print  {
@@ -247,6 +278,7 @@ class OLEDDisplay : public Stream {
 
     // Draws a string at the given location, returns how many chars have been written
     uint16_t drawString(int16_t x, int16_t y, const String &text);
+    uint16_t drawString(int16_t x, int16_t y, const char* text);
 
     // Draws a formatted string (like printf) at the given location
     void drawStringf(int16_t x, int16_t y, char* buffer, String format, ... );
@@ -257,6 +289,7 @@ class OLEDDisplay : public Stream {
     // returns 0 if everything fits on the screen or the numbers of characters in the
     // first line if not
     uint16_t drawStringMaxWidth(int16_t x, int16_t y, uint16_t maxLineWidth, const String &text);
+    uint16_t drawStringMaxWidth(int16_t x, int16_t y, uint16_t maxLineWidth, const char* text);
 
     // Returns the width of the const char* with the current
     // font settings
@@ -264,6 +297,7 @@ class OLEDDisplay : public Stream {
 
     // Convencience method for the const char version
     uint16_t getStringWidth(const String &text);
+    uint16_t getStringWidth(const char* text) { return getStringWidth(text, strlen(text)); }
 
     // Specifies relative to which anchor point
     // the text is rendered. Available constants:
@@ -389,6 +423,17 @@ class OLEDDisplay : public Stream {
 
     uint16_t drawStringInternal(int16_t xMove, int16_t yMove, const char* text, uint16_t textLength, uint16_t textWidth, bool utf8);
 
+    // Text layout cache. Frames are usually redrawn with mostly the same strings, so measuring and
+    // word wrapping is done once per string, then re-used until the entry is evicted (LRU)
+    OLEDDisplayTextLayout  layoutCache[OLEDDISPLAY_LAYOUT_CACHE_SIZE > 0 ? OLEDDISPLAY_LAYOUT_CACHE_SIZE : 1];
+    OLEDDisplayTextLayout  layoutTemp;    // when cache is disabled, or text is too long to cache
+    uint32_t               layoutClock;
+
+    const OLEDDisplayTextLayout* getTextLayout(const char* text, uint16_t maxLineWidth);
+    bool layoutText(OLEDDisplayTextLayout* layout, const char* text);
+    bool addLayoutLine(OLEDDisplayTextLayout* layout, uint16_t& capacity, uint16_t start, uint16_t length, uint16_t width);
+    void clearLayoutCache();
+
 	FontTableLookupFunction fontTableLookupFunction;
 };
 
@@ -30,6 +30,8 @@ void SH1106Display::clear()
 {
   display.clearDisplay();
   display.display();
+  memset(_shadow, 0, sizeof(_shadow));
+  _shadow_valid = true;
 }
 
 void SH1106Display::startFrame(Color bkg)
@@ -85,7 +87,45 @@ uint16_t SH1106Display::getTextWidth(const char *str)
   return w;
 }
 
+void SH1106Display::sendPage(int page, int x0, int x1)
+{
+  int col = x0 + SH1106_COLUMN_OFFSET;
+  display.oled_command(SH110X_SETPAGEADDR + page);
+  display.oled_command(0x10 | (col >> 4)); // column address, high nibble
+  display.oled_command(col & 0x0F);        // column address, low nibble
+
+  const uint8_t *src = &display.getBuffer()[page * width() + x0];
+  int n = x1 - x0 + 1;
+  while (n > 0)
+  {
+    int len = n > OLED_I2C_CHUNK ? OLED_I2C_CHUNK : n;
+    Wire.beginTransmission(DISPLAY_ADDRESS);
+    Wire.write((uint8_t)0x40); // Co = 0, D/C = 1  (data bytes follow)
+    Wire.write(src, len);
+    Wire.endTransmission();
+    src += len;
+    n -= len;
+  }
+}
+
 void SH1106Display::endFrame()
 {
-  display.display();
+  if (!_shadow_valid)
+  { // panel contents unknown, send everything
+    display.display();
+    memcpy(_shadow, display.getBuffer(), sizeof(_shadow));
+    _shadow_valid = true;
+    return;
+  }
+
+  // only send the changed column span of each changed page
+  const uint8_t *buf = display.getBuffer();
+  int x0, x1;
+  for (int page = 0; page < height() / 8; page++)
+  {
+    if (diffPage(&buf[page * width()], &_shadow[page * width()], width(), x0, x1))
+    {
+      sendPage(page, x0, x1);
+    }
+  }
 }
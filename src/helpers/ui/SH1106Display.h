@@ -14,16 +14,27 @@
 #define DISPLAY_ADDRESS 0x3C
 #endif
 
+#ifndef SH1106_COLUMN_OFFSET
+#define SH1106_COLUMN_OFFSET 2 // SH1106 RAM is 132 columns wide, panel is centred
+#endif
+
+#ifndef OLED_I2C_CHUNK
+#define OLED_I2C_CHUNK 16 // max data bytes per I2C transmission (some Wire impls only buffer 32)
+#endif
+
 class SH1106Display : public DisplayDriver
 {
   Adafruit_SH1106G display;
   bool _isOn;
   uint8_t _color;
+  uint8_t _shadow[128 * 64 / 8]; // what is currently in the panel's RAM
+  bool _shadow_valid;
 
   bool i2c_probe(TwoWire &wire, uint8_t addr);
+  void sendPage(int page, int x0, int x1);
 
 public:
-  SH1106Display() : DisplayDriver(128, 64), display(128, 64, &Wire, PIN_OLED_RESET) { _isOn = false; }
+  SH1106Display() : DisplayDriver(128, 64), display(128, 64, &Wire, PIN_OLED_RESET) { _isOn = false; _shadow_valid = false; }
   bool begin();
 
   bool isOn() override { return _isOn; }
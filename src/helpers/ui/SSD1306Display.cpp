@@ -23,6 +23,8 @@ void SSD1306Display::turnOff() {
 void SSD1306Display::clear() {
   display.clearDisplay();
   display.display();
+  memset(_shadow, 0, sizeof(_shadow));
+  _shadow_valid = true;
 }
 
 void SSD1306Display::startFrame(Color bkg) {
@@ -69,6 +71,41 @@ uint16_t SSD1306Display::getTextWidth(const char* str) {
   return w;
 }
 
+void SSD1306Display::sendPage(int page, int x0, int x1) {
+  display.ssd1306_command(SSD1306_PAGEADDR);
+  display.ssd1306_command(page);
+  display.ssd1306_command(page);
+  display.ssd1306_command(SSD1306_COLUMNADDR);
+  display.ssd1306_command(x0);
+  display.ssd1306_command(x1);
+
+  const uint8_t* src = &display.getBuffer()[page * width() + x0];
+  int n = x1 - x0 + 1;
+  while (n > 0) {
+    int len = n > OLED_I2C_CHUNK ? OLED_I2C_CHUNK : n;
+    Wire.beginTransmission(DISPLAY_ADDRESS);
+    Wire.write((uint8_t) 0x40);   // Co = 0, D/C = 1  (data bytes follow)
+    Wire.write(src, len);
+    Wire.endTransmission();
+    src += len;
+    n -= len;
+  }
+}
+
 void SSD1306Display::endFrame() {
-  display.display();
+  if (!_shadow_valid) {   // panel contents unknown, send everything
+    display.display();
+    memcpy(_shadow, display.getBuffer(), sizeof(_shadow));
+    _shadow_valid = true;
+    return;
+  }
+
+  // only send the changed column span of each changed page
+  const uint8_t* buf = display.getBuffer();
+  int x0, x1;
+  for (int page = 0; page < height() / 8; page++) {
+    if (diffPage(&buf[page * width()], &_shadow[page * width()], width(), x0, x1)) {
+      sendPage(page, x0, x1);
+    }
+  }
 }
@@ -14,14 +14,21 @@
   #define DISPLAY_ADDRESS   0x3C
 #endif
 
+#ifndef OLED_I2C_CHUNK
+  #define OLED_I2C_CHUNK    16   // max data bytes per I2C transmission (some Wire impls only buffer 32)
+#endif
+
 class SSD1306Display : public DisplayDriver {
   Adafruit_SSD1306 display;
   bool _isOn;
   uint8_t _color;
+  uint8_t _shadow[128 * 64 / 8];   // what is currently in the panel's RAM
+  bool _shadow_valid;
 
   bool i2c_probe(TwoWire& wire, uint8_t addr);
+  void sendPage(int page, int x0, int x1);
 public:
-  SSD1306Display() : DisplayDriver(128, 64), display(128, 64, &Wire, PIN_OLED_RESET) { _isOn = false; }
+  SSD1306Display() : DisplayDriver(128, 64), display(128, 64, &Wire, PIN_OLED_RESET) { _isOn = false; _shadow_valid = false; }
   bool begin();
 
   bool isOn() override { return _isOn; }
@@ -24,10 +24,24 @@ bool ST7735Display::begin() {
     digitalWrite(PIN_TFT_LEDA_CTL, HIGH);
     digitalWrite(PIN_TFT_RST, HIGH);
 
+  #ifdef ST7735_PIN_SPI
+    _tft_spi.begin(PIN_TFT_SCL, -1, PIN_TFT_SDA, PIN_TFT_CS);   // NOTE: initR() won't re-begin() with default pins
+  #endif
     display.initR(INITR_MINI160x80_PLUGIN);
     display.setRotation(DISPLAY_ROTATION);
     display.setSPISpeed(40000000);
     display.fillScreen(ST77XX_BLACK);
+
+    if (_canvas == NULL) {
+      _canvas = new GFXcanvas16(display.width(), display.height());
+      if (_canvas->getBuffer() == NULL) {   // not enough RAM, just draw direct to panel
+        delete _canvas;
+        _canvas = NULL;
+      } else {
+        _row_sigs = new uint32_t[display.height()];
+      }
+    }
+    _sigs_valid = false;   // panel was reset
     display.setTextColor(ST77XX_WHITE);
     display.setTextSize(2); 
     display.cp437(true);         // Use full 256 char 'Code Page 437' font
@@ -55,17 +69,19 @@ void ST7735Display::turnOff() {
 void ST7735Display::clear() {
   //Serial.println("DBG: display.Clear");
   display.fillScreen(ST77XX_BLACK);
+  if (_canvas) _canvas->fillScreen(ST77XX_BLACK);
+  _sigs_valid = false;
 }
 
 void ST7735Display::startFrame(Color bkg) {
-  display.fillScreen(0x00);
-  display.setTextColor(ST77XX_WHITE);
-  display.setTextSize(1);      // This one affects size of Please wait... message
-  display.cp437(true);         // Use full 256 char 'Code Page 437' font
+  gfx().fillScreen(0x00);
+  gfx().setTextColor(ST77XX_WHITE);
+  gfx().setTextSize(1);      // This one affects size of Please wait... message
+  gfx().cp437(true);         // Use full 256 char 'Code Page 437' font
 }
 
 void ST7735Display::setTextSize(int sz) {
-  display.setTextSize(sz);
+  gfx().setTextSize(sz);
 }
 
 void ST7735Display::setColor(Color c) {
@@ -95,36 +111,75 @@ void ST7735Display::setColor(Color c) {
       _color = ST77XX_WHITE;
       break;
   }
-  display.setTextColor(_color);
+  gfx().setTextColor(_color);
 }
 
 void ST7735Display::setCursor(int x, int y) {
-  display.setCursor(x*SCALE_X, y*SCALE_Y);
+  gfx().setCursor(x*SCALE_X, y*SCALE_Y);
 }
 
 void ST7735Display::print(const char* str) {
-  display.print(str);
+  gfx().print(str);
 }
 
 void ST7735Display::fillRect(int x, int y, int w, int h) {
-  display.fillRect(x*SCALE_X, y*SCALE_Y, w*SCALE_X, h*SCALE_Y, _color);
+  gfx().fillRect(x*SCALE_X, y*SCALE_Y, w*SCALE_X, h*SCALE_Y, _color);
 }
 
 void ST7735Display::drawRect(int x, int y, int w, int h) {
-  display.drawRect(x*SCALE_X, y*SCALE_Y, w*SCALE_X, h*SCALE_Y, _color);
+  gfx().drawRect(x*SCALE_X, y*SCALE_Y, w*SCALE_X, h*SCALE_Y, _color);
 }
 
 void ST7735Display::drawXbm(int x, int y, const uint8_t* bits, int w, int h) {
-  display.drawBitmap(x*SCALE_X, y*SCALE_Y, bits, w, h, _color);
+  gfx().drawBitmap(x*SCALE_X, y*SCALE_Y, bits, w, h, _color);
 }
 
 uint16_t ST7735Display::getTextWidth(const char* str) {
   int16_t x1, y1;
   uint16_t w, h;
-  display.getTextBounds(str, 0, 0, &x1, &y1, &w, &h);
+  gfx().getTextBounds(str, 0, 0, &x1, &y1, &w, &h);
   return w / SCALE_X;
 }
 
+bool ST7735Display::updateRowSig(int y) {
+  int w = _canvas->width();
+  const uint8_t* p = (const uint8_t *) &_canvas->getBuffer()[y * w];
+  uint32_t h = 2166136261UL;   // FNV-1a
+  for (int i = 0; i < w*2; i++) { h ^= p[i]; h *= 16777619UL; }
+
+  bool changed = !_sigs_valid || h != _row_sigs[y];
+  _row_sigs[y] = h;
+  return changed;
+}
+
 void ST7735Display::endFrame() {
-  // display.display();
+  if (_canvas == NULL) return;   // was drawn direct to panel
+
+  // send each run of changed rows as one window + one bulk write. Where Adafruit_SPITFT has DMA,
+  // the write is started non-blocking, so hashing the following rows overlaps with the transfer
+  int w = _canvas->width(), h = _canvas->height();
+  uint16_t* buf = _canvas->getBuffer();
+  bool started = false;
+  int run_start = -1;
+  for (int y = 0; y <= h; y++) {
+    bool changed = y < h && updateRowSig(y);
+    if (changed) {
+      if (run_start < 0) run_start = y;
+    } else if (run_start >= 0) {
+      if (started) {
+        display.dmaWait();   // previous run must complete before next window is set
+      } else {
+        display.startWrite();
+        started = true;
+      }
+      display.setAddrWindow(0, run_start, w, y - run_start);
+      display.writePixels(&buf[run_start * w], w * (y - run_start), false);
+      run_start = -1;
+    }
+  }
+  if (started) {
+    display.dmaWait();
+    display.endWrite();
+  }
+  _sigs_valid = true;
 }
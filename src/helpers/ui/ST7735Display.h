@@ -7,27 +7,47 @@
 #include <Adafruit_ST7735.h>
 #include <helpers/RefCountedDigitalPin.h>
 
+#if defined(USE_PIN_TFT) && defined(ESP32)
+  #define ST7735_PIN_SPI   1   // route hardware SPI to the TFT pins, instead of bit-banging them
+#endif
+
 class ST7735Display : public DisplayDriver {
+#ifdef ST7735_PIN_SPI
+  SPIClass _tft_spi;   // NOTE: must be declared before 'display'
+#endif
   Adafruit_ST7735 display;
   bool _isOn;
   uint16_t _color;
   RefCountedDigitalPin* _peripher_power;
+  GFXcanvas16* _canvas;     // frame is composed off-screen, then changed rows are sent in bulk
+  uint32_t* _row_sigs;      // hash of each canvas row, as last sent to panel
+  bool _sigs_valid;
 
   bool i2c_probe(TwoWire& wire, uint8_t addr);
+  Adafruit_GFX& gfx() { return _canvas ? (Adafruit_GFX&) *_canvas : (Adafruit_GFX&) display; }
+  bool updateRowSig(int y);
 public:
-#ifdef USE_PIN_TFT
+#ifdef ST7735_PIN_SPI
+  ST7735Display(RefCountedDigitalPin* peripher_power=NULL) : DisplayDriver(128, 64),
+      _tft_spi(HSPI),
+      display(&_tft_spi, PIN_TFT_CS, PIN_TFT_DC, PIN_TFT_RST),
+      _peripher_power(peripher_power)
+  {
+    _isOn = false; _canvas = NULL; _row_sigs = NULL; _sigs_valid = false;
+  }
+#elif defined(USE_PIN_TFT)
   ST7735Display(RefCountedDigitalPin* peripher_power=NULL) : DisplayDriver(128, 64), 
       display(PIN_TFT_CS, PIN_TFT_DC, PIN_TFT_SDA, PIN_TFT_SCL, PIN_TFT_RST),
       _peripher_power(peripher_power)
   {
-    _isOn = false;
+    _isOn = false; _canvas = NULL; _row_sigs = NULL; _sigs_valid = false;
   }
 #else
   ST7735Display(RefCountedDigitalPin* peripher_power=NULL) : DisplayDriver(128, 64),
       display(&SPI1, PIN_TFT_CS, PIN_TFT_DC, PIN_TFT_RST),
       _peripher_power(peripher_power)
   {
-    _isOn = false;
+    _isOn = false; _canvas = NULL; _row_sigs = NULL; _sigs_valid = false;
   }
 #endif
   bool begin();
@@ -106,6 +106,7 @@ class ST7789Spi : public OLEDDisplay {
       SPISettings 		    _spiSettings;
       uint16_t            _RGB=0xFFFF;
       uint8_t             _buffheight;
+      uint16_t           *_pagebuf = NULL;    // one page (8 rows) of converted pixels
   public:
     /* pass _cs as -1 to indicate "do not use CS pin", for cases where it is hard wired low */
     ST7789Spi(SPIClass *spiClass,uint8_t _rst, uint8_t _dc, uint8_t _cs, OLEDDISPLAY_GEOMETRY g = GEOMETRY_RAWMODE,uint16_t width=240,uint16_t height=135,int mosi=-1,int miso=-1,int clk=-1) {
@@ -152,61 +153,55 @@ class ST7789Spi : public OLEDDisplay {
 
     void display(void) {
     #ifdef OLEDDISPLAY_DOUBLE_BUFFER
-
-       uint16_t minBoundY = UINT16_MAX;
-       uint16_t maxBoundY = 0;
-
-       uint16_t minBoundX = UINT16_MAX;
-       uint16_t maxBoundX = 0;
-
+       // Each 8-row page gets its own window, spanning just the changed columns of that page,
+       // so a change at the top and another at the bottom don't drag in everything in between.
+       // The whole window is colour converted into _pagebuf once, then sent as ONE bulk transfer
+       // (a single EasyDMA transaction on nRF52), rather than a window + transfer per pixel row
+       if (_pagebuf == NULL) {
+         _pagebuf = (uint16_t *)rtos_malloc(2 * 8 * displayWidth);   // kept for lifetime of display
+         if (_pagebuf == NULL) return;
+       }
+       bool started = false;
        uint16_t x, y;
-        
-       // Calculate the Y bounding box of changes
-       // and copy buffer[pos] to buffer_back[pos];
+
        for (y = 0; y < _buffheight; y++) {
+         uint8_t *row = &buffer[y * displayWidth];
+         uint8_t *row_back = &buffer_back[y * displayWidth];
+         int16_t minBoundX = -1, maxBoundX = -1;
          for (x = 0; x < displayWidth; x++) {
-          //Serial.printf("x  %d y %d\r\n",x,y);
-          uint16_t pos = x + y * displayWidth;
-          if (buffer[pos] != buffer_back[pos]) {
-            minBoundY = min(minBoundY, y);
-            maxBoundY = max(maxBoundY, y);
-            minBoundX = min(minBoundX, x);
-            maxBoundX = max(maxBoundX, x);
-          }
-          buffer_back[pos] = buffer[pos];
-        }
-        yield();
-       }
-
-       // If the minBoundY wasn't updated
-       // we can savely assume that buffer_back[pos] == buffer[pos]
-       // holdes true for all values of pos
-       if (minBoundY == UINT16_MAX) return;
-
-		  set_CS(LOW);
-		  _spi->beginTransaction(_spiSettings);
-
-          for (y = minBoundY; y <= maxBoundY; y++)
-          {
-            for(int temp = 0; temp<8;temp++)
-            {
-              //setAddrWindow(minBoundX,y*8+temp,maxBoundX-minBoundX+1,1);
-              setAddrWindow(minBoundX,y*8+temp,maxBoundX-minBoundX+1,1);
-              //setAddrWindow(y*8+temp,minBoundX,1,maxBoundX-minBoundX+1);
-              uint32_t const pixbufcount = maxBoundX-minBoundX+1;
-              uint16_t *pixbuf = (uint16_t *)rtos_malloc(2 * pixbufcount);
-              for (x = minBoundX; x <= maxBoundX; x++)
-              {
-                pixbuf[x-minBoundX] = ((buffer[x + y * displayWidth]>>temp)&0x01)==1?_RGB:0;
-              }
+           if (row[x] != row_back[x]) {
+             if (minBoundX < 0) minBoundX = x;
+             maxBoundX = x;
+             row_back[x] = row[x];
+           }
+         }
+         if (minBoundX < 0) continue;   // page unchanged
+
+         uint16_t const w = maxBoundX-minBoundX+1;
+         uint16_t rows = displayHeight - y*8;
+         if (rows > 8) rows = 8;
+
+         uint16_t *dest = _pagebuf;
+         for (int temp = 0; temp < rows; temp++) {
+           for (x = minBoundX; x <= maxBoundX; x++) {
+             *dest++ = ((row[x]>>temp)&0x01)==1?_RGB:0;
+           }
+         }
+
+         if (!started) {   // first changed page
+           started = true;
+           set_CS(LOW);
+           _spi->beginTransaction(_spiSettings);
+         }
+         setAddrWindow(minBoundX,y*8,w,rows);
 #ifdef ESP_PLATFORM
-              _spi->transferBytes((uint8_t *)pixbuf, NULL, 2 * pixbufcount);
+         _spi->transferBytes((uint8_t *)_pagebuf, NULL, 2 * w * rows);
 #else
-              _spi->transfer(pixbuf, NULL, 2 * pixbufcount);
+         _spi->transfer(_pagebuf, NULL, 2 * w * rows);
 #endif
-              rtos_free(pixbuf);
-            }
-          }
+       }
+
+       if (!started) return;   // nothing changed
 	  _spi->endTransaction();
 	  set_CS(HIGH);
 
@@ -25,6 +25,7 @@ void radio_set_params(float freq, float bw, uint8_t sf, uint8_t cr) {
   radio.setSpreadingFactor(sf);
   radio.setBandwidth(bw);
   radio.setCodingRate(cr);
+  radio_driver.resetAirtimeTable();   // time-on-air depends on params
 }
 
 void radio_set_tx_power(uint8_t dbm) {